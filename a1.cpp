@@ -1,112 +1,684 @@
 // eight_puzzle_search.cpp
 #include <iostream>
+#include <iomanip>
 #include <vector>
-#include <queue>
-#include <stack>
-#include <unordered_set>
-#include <unordered_map>
+#include <array>
 #include <algorithm>
 #include <string>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 using namespace std;
 
-using State = array<int,9>;
-string to_key(const State &s){ string k; for(int x:s){ k+=char(x+ '0'); } return k; }
-int inv_count(const State &s){
+// Sliding-tile boards of width W (3 = 8-puzzle, 4 = 15-puzzle, 5 = 24-puzzle).
+template<int W> using Board = array<int,W*W>;
+using State = Board<3>;
+
+template<int W> int inv_count(const Board<W> &s){
     int inv=0;
-    for(int i=0;i<9;i++) if(s[i])
-        for(int j=i+1;j<9;j++) if(s[j] && s[i]>s[j]) inv++;
+    for(int i=0;i<W*W;i++) if(s[i])
+        for(int j=i+1;j<W*W;j++) if(s[j] && s[i]>s[j]) inv++;
     return inv;
 }
-bool solvable(const State &start,const State &goal){
-    return (inv_count(start)%2)==(inv_count(goal)%2);
+template<int W> bool solvable(const Board<W> &start,const Board<W> &goal){
+    int ps=inv_count<W>(start), pg=inv_count<W>(goal);
+    if(W%2==0){ // on even widths every vertical blank move also flips inversion parity
+        ps+=int(find(start.begin(),start.end(),0)-start.begin())/W;
+        pg+=int(find(goal.begin(),goal.end(),0)-goal.begin())/W;
+    }
+    return (ps%2)==(pg%2);
+}
+// True if b holds each tile 0..W*W-1 exactly once. Ranks, heuristics and
+// pattern lookups all index tables by tile, so input is checked before use.
+template<int W> bool valid_board(const Board<W> &b){
+    bool seen[W*W]={};
+    for(int t: b){ if(t<0 || t>=W*W || seen[t]) return false; seen[t]=true; }
+    return true;
 }
-vector<State> neighbors(const State &s){
-    int z=-1; for(int i=0;i<9;i++) if(s[i]==0) { z=i; break;}
-    int r=z/3,c=z%3;
-    vector<State> out;
+// Writes up to 4 successors into out and returns how many there are.
+template<int W> int neighbors(const Board<W> &s, Board<W> out[4]){
+    int z=-1; for(int i=0;i<W*W;i++) if(s[i]==0) { z=i; break;}
+    int r=z/W,c=z%W, n=0;
     const int dr[4]={-1,1,0,0}, dc[4]={0,0,-1,1};
     for(int k=0;k<4;k++){
         int nr=r+dr[k], nc=c+dc[k];
-        if(nr>=0 && nr<3 && nc>=0 && nc<3){
-            State t=s;
-            swap(t[z], t[nr*3+nc]);
-            out.push_back(t);
+        if(nr>=0 && nr<W && nc>=0 && nc<W){
+            out[n]=s;
+            swap(out[n][z], out[n][nr*W+nc]);
+            n++;
         }
     }
-    return out;
+    return n;
 }
-void print_state(const State &s){
-    for(int i=0;i<9;i++){
-        if(s[i]==0) cout<<' ';
-        else cout<<s[i];
-        if(i%3==2) cout<<"\n"; else cout<<" ";
+template<int W> void print_state(const Board<W> &s){
+    int width = W*W>10 ? 2 : 1;
+    for(int i=0;i<W*W;i++){
+        if(s[i]==0) cout<<setw(width)<<' ';
+        else cout<<setw(width)<<s[i];
+        if(i%W==W-1) cout<<"\n"; else cout<<" ";
     }
     cout<<"\n";
 }
+template<int W> Board<W> default_goal(){
+    Board<W> g;
+    for(int i=0;i<W*W;i++) g[i]=(i+1)%(W*W);
+    return g;
+}
+
+// 3x3 only: every state is identified by its Lehmer-code rank in [0, 9!), so
+// visited/parent data lives in flat tables instead of string-keyed hash maps.
+const int NSTATES = 362880; // 9!
+const uint32_t NONE = UINT32_MAX;
+const int FACT[9] = {40320,5040,720,120,24,6,2,1,1};
+uint32_t rank_state(const State &s){
+    uint32_t r=0;
+    for(int i=0;i<9;i++){
+        int smaller=0;
+        for(int j=i+1;j<9;j++) if(s[j]<s[i]) smaller++;
+        r+=smaller*FACT[i];
+    }
+    return r;
+}
+State unrank_state(uint32_t r){
+    State s; bool used[9]={};
+    for(int i=0;i<9;i++){
+        int k=r/FACT[i]; r%=FACT[i];
+        for(int v=0;v<9;v++) if(!used[v] && k--==0){ s[i]=v; used[v]=true; break; }
+    }
+    return s;
+}
 
 // BFS
-bool bfs_solve(const State &start,const State &goal, vector<State> &path){
-    queue<State> q; unordered_map<string,string> parent; // key->parentkey
-    string sk=to_key(start), gk=to_key(goal);
-    q.push(start); parent[sk]="";
-    while(!q.empty()){
-        State cur=q.front(); q.pop();
-        string ck=to_key(cur);
-        if(ck==gk){
+bool bfs_solve(const State &start,const State &goal, vector<State> &path, size_t *expanded=nullptr){
+    path.clear();
+    if(!valid_board<3>(start) || !valid_board<3>(goal)) return false; // ranks would fall outside [0, 9!)
+    // queue and parent table are sized for the whole state space up front
+    vector<uint32_t> q(NSTATES), parent(NSTATES, NONE);
+    uint32_t sr=rank_state(start), gr=rank_state(goal);
+    size_t head=0, tail=0;
+    q[tail++]=sr; parent[sr]=sr;
+    State nb[4];
+    while(head<tail){
+        uint32_t cr=q[head++];
+        if(cr==gr){
+            if(expanded) *expanded=head-1;
             // reconstruct
             path.clear();
-            string curk = gk;
-            while(curk!=""){
-                State s;
-                for(int i=0;i<9;i++) s[i]=curk[i]-'0';
-                path.push_back(s);
-                curk = parent[curk];
+            for(uint32_t r=gr;;r=parent[r]){
+                path.push_back(unrank_state(r));
+                if(r==sr) break;
             }
             reverse(path.begin(), path.end());
             return true;
         }
-        for(auto &n: neighbors(cur)){
-            string nk=to_key(n);
-            if(!parent.count(nk)){
-                parent[nk]=ck;
-                q.push(n);
+        int n=neighbors<3>(unrank_state(cr), nb);
+        for(int k=0;k<n;k++){
+            uint32_t nr=rank_state(nb[k]);
+            if(parent[nr]==NONE){
+                parent[nr]=cr;
+                q[tail++]=nr;
             }
         }
     }
     return false;
 }
 
-// IDDFS wrapper for DFS
-bool dls(const State &cur,const State &goal,int depth, unordered_set<string> &visited, vector<State> &path){
-    string ck=to_key(cur);
-    if(ck==to_key(goal)){ path.push_back(cur); return true; }
-    if(depth==0) return false;
-    visited.insert(ck);
-    for(auto &n: neighbors(cur)){
-        string nk=to_key(n);
-        if(visited.count(nk)) continue;
-        if(dls(n,goal,depth-1,visited,path)){
-            path.push_back(cur);
+// Bidirectional BFS: one level at a time from whichever side has the smaller
+// frontier. Both searches share the side/depth/parent tables, so a state first
+// reached by the other side is a meeting point; the cheapest meeting seen while
+// finishing that level splices into a shortest path.
+bool bibfs_solve(const State &start,const State &goal, vector<State> &path, size_t *expanded=nullptr){
+    path.clear();
+    if(!valid_board<3>(start) || !valid_board<3>(goal)) return false; // ranks would fall outside [0, 9!)
+    vector<uint8_t> side(NSTATES, 0), depth(NSTATES, 0); // side: 1 = from start, 2 = from goal
+    vector<uint32_t> parent(NSTATES, NONE);
+    uint32_t sr=rank_state(start), gr=rank_state(goal);
+    size_t count=0;
+    if(sr==gr){ path.push_back(start); if(expanded) *expanded=0; return true; }
+    vector<uint32_t> front[3], next;
+    front[1].push_back(sr); side[sr]=1; parent[sr]=sr;
+    front[2].push_back(gr); side[gr]=2; parent[gr]=gr;
+    State nb[4];
+    while(!front[1].empty() && !front[2].empty()){
+        int s = front[1].size()<=front[2].size() ? 1 : 2;
+        int best=INT32_MAX; uint32_t meet_a=NONE, meet_b=NONE;
+        next.clear();
+        for(uint32_t cr: front[s]){
+            count++;
+            int n=neighbors<3>(unrank_state(cr), nb);
+            for(int k=0;k<n;k++){
+                uint32_t nr=rank_state(nb[k]);
+                if(side[nr]==0){
+                    side[nr]=s; depth[nr]=depth[cr]+1; parent[nr]=cr;
+                    next.push_back(nr);
+                } else if(side[nr]!=s && depth[cr]+1+depth[nr]<best){
+                    best=depth[cr]+1+depth[nr]; meet_a=cr; meet_b=nr;
+                }
+            }
+        }
+        if(meet_a!=NONE){
+            if(s==2) swap(meet_a, meet_b); // meet_a on the start side
+            for(uint32_t r=meet_a;;r=parent[r]){ path.push_back(unrank_state(r)); if(r==sr) break; }
+            reverse(path.begin(), path.end());
+            for(uint32_t r=meet_b;;r=parent[r]){ path.push_back(unrank_state(r)); if(r==gr) break; }
+            if(expanded) *expanded=count;
             return true;
         }
+        front[s].swap(next);
     }
-    visited.erase(ck);
     return false;
 }
-bool iddfs_solve(const State &start,const State &goal, vector<State> &path,int max_depth=30){
-    for(int d=0;d<=max_depth;d++){
-        unordered_set<string> visited; path.clear();
-        if(dls(start,goal,d,visited,path)){
-            reverse(path.begin(), path.end());
-            return true;
+
+// Level-synchronous parallel BFS over every 8-puzzle state reachable from root.
+// A pool of workers claims chunks of the shared frontier, marks states in an
+// atomic visited bitmap (fetch_or decides which worker owns a state) and
+// appends the states it owns to a thread-local next frontier. dist[rank] gets
+// the depth of each reached state, 255 elsewhere.
+struct LevelStats { size_t frontier; double ms; };
+class Barrier {
+    mutex m; condition_variable cv;
+    int n, waiting=0; size_t gen=0;
+public:
+    explicit Barrier(int n):n(n){}
+    void wait(){
+        unique_lock<mutex> lk(m);
+        size_t g=gen;
+        if(++waiting==n){ waiting=0; gen++; cv.notify_all(); }
+        else cv.wait(lk, [&]{ return gen!=g; });
+    }
+};
+vector<LevelStats> parallel_bfs(const State &root, int threads, vector<uint8_t> &dist){
+    const size_t CHUNK=1024;
+    vector<atomic<uint64_t>> visited((NSTATES+63)/64);
+    for(auto &w: visited) w.store(0, memory_order_relaxed);
+    dist.assign(NSTATES, 255);
+    vector<uint32_t> frontier;
+    vector<vector<uint32_t>> local(threads);
+    atomic<size_t> cursor(0);
+    bool done=false;
+    int depth=0;
+    Barrier barrier(threads+1); // workers + this coordinating thread
+
+    uint32_t rr=rank_state(root);
+    visited[rr>>6].fetch_or(1ull<<(rr&63));
+    dist[rr]=0;
+    frontier.push_back(rr);
+
+    auto worker=[&](int id){
+        State nb[4];
+        for(;;){
+            barrier.wait(); // level start
+            if(done) return;
+            auto &next=local[id];
+            next.clear();
+            for(;;){
+                size_t b=cursor.fetch_add(CHUNK, memory_order_relaxed);
+                if(b>=frontier.size()) break;
+                size_t e=min(b+CHUNK, frontier.size());
+                for(size_t i=b;i<e;i++){
+                    int n=neighbors<3>(unrank_state(frontier[i]), nb);
+                    for(int k=0;k<n;k++){
+                        uint32_t nr=rank_state(nb[k]);
+                        uint64_t bit=1ull<<(nr&63);
+                        if(visited[nr>>6].load(memory_order_relaxed)&bit) continue;
+                        if(visited[nr>>6].fetch_or(bit, memory_order_relaxed)&bit) continue;
+                        dist[nr]=depth+1;
+                        next.push_back(nr);
+                    }
+                }
+            }
+            barrier.wait(); // level end
+        }
+    };
+    vector<thread> pool;
+    for(int i=0;i<threads;i++) pool.emplace_back(worker, i);
+
+    vector<LevelStats> stats;
+    while(!frontier.empty()){
+        auto t0=chrono::steady_clock::now();
+        cursor=0;
+        barrier.wait();
+        barrier.wait();
+        stats.push_back({frontier.size(), chrono::duration<double,milli>(chrono::steady_clock::now()-t0).count()});
+        frontier.clear();
+        for(auto &l: local) frontier.insert(frontier.end(), l.begin(), l.end());
+        depth++;
+    }
+    done=true;
+    barrier.wait();
+    for(auto &t: pool) t.join();
+    return stats;
+}
+
+// Distance-to-goal for every 8-puzzle state, one byte per permutation rank
+// (255 = unreachable), from a single retrograde BFS out of the goal.
+// File layout: magic "8PDIST1", the 9 goal tiles, then NSTATES bytes.
+struct DistanceTable {
+    State goal;
+    vector<uint8_t> dist;
+
+    void build(const State &g, int threads=1){
+        goal=g;
+        parallel_bfs(goal, threads, dist);
+    }
+    bool save(const string &file) const {
+        FILE *f=fopen(file.c_str(),"wb");
+        if(!f) return false;
+        uint8_t g[9]; for(int i=0;i<9;i++) g[i]=goal[i];
+        bool ok = fwrite("8PDIST1",8,1,f)==1 && fwrite(g,9,1,f)==1 && fwrite(dist.data(),1,NSTATES,f)==size_t(NSTATES);
+        return fclose(f)==0 && ok;
+    }
+    bool load(const string &file){
+        FILE *f=fopen(file.c_str(),"rb");
+        if(!f) return false;
+        char magic[8]; uint8_t g[9];
+        dist.resize(NSTATES);
+        bool ok = fread(magic,8,1,f)==1 && memcmp(magic,"8PDIST1",8)==0 && fread(g,9,1,f)==1
+               && fread(dist.data(),1,NSTATES,f)==size_t(NSTATES);
+        fclose(f);
+        if(ok) for(int i=0;i<9;i++) goal[i]=g[i];
+        return ok;
+    }
+    // Optimal path by stepping to any neighbor one move closer to the goal.
+    bool path_to_goal(const State &start, vector<State> &path) const {
+        path.assign(1, start);
+        uint8_t d=dist[rank_state(start)];
+        if(d==255) return false;
+        State nb[4];
+        while(d>0){
+            int n=neighbors<3>(path.back(), nb);
+            for(int k=0;k<n;k++) if(dist[rank_state(nb[k])]==d-1){ path.push_back(nb[k]); break; }
+            d--;
         }
+        return true;
     }
-    return false;
+};
+
+// Disjoint additive pattern databases.
+// Each group is a set of goal cells; its table stores the minimum number of moves
+// of the tiles belonging to those cells (other tiles' moves are free), indexed by
+// the k-permutation rank of where those tiles currently are. Because no move is
+// counted by two groups, the per-group values can be summed.
+// File layout: Header, then one byte table of P(N,k) entries per group.
+template<int W> struct PatternDB {
+    static const int N = W*W, MAXG = 8;
+    struct Header {
+        char magic[8]; // "STPDB1"
+        uint32_t width, ngroups;
+        uint32_t size[MAXG];
+        uint8_t cells[MAXG][N];
+    };
+    const Header *hdr = nullptr;
+    const uint8_t *tables[MAXG] = {};
+    void *map = MAP_FAILED; size_t map_len = 0;
+
+    PatternDB() = default;
+    PatternDB(const PatternDB&) = delete;
+    PatternDB& operator=(const PatternDB&) = delete;
+    ~PatternDB(){ if(map!=MAP_FAILED) munmap(map, map_len); }
+
+    // P(n,k) = n!/(n-k)!
+    static uint64_t perms(int n, int k){ uint64_t p=1; for(int i=0;i<k;i++) p*=n-i; return p; }
+    static uint64_t rank_positions(const int *pos, int k){
+        uint64_t r=0;
+        for(int i=0;i<k;i++){
+            int d=pos[i];
+            for(int j=0;j<i;j++) if(pos[j]<pos[i]) d--;
+            r=r*(N-i)+d;
+        }
+        return r;
+    }
+    static void unrank_positions(uint64_t r, int *pos, int k){
+        int digit[N+1];
+        for(int i=k-1;i>=0;i--){ digit[i]=r%(N-i); r/=(N-i); }
+        bool used[N]={};
+        for(int i=0;i<k;i++){
+            int d=digit[i];
+            for(int p=0;p<N;p++) if(!used[p] && d--==0){ pos[i]=p; used[p]=true; break; }
+        }
+    }
+
+    // 6-6-3 for the 15-puzzle, six groups of 4 for the 24-puzzle, 4-4 for the 8-puzzle;
+    // all assume the blank's goal cell is the last one.
+    static vector<vector<int>> default_groups(){
+        if(W==4) return {{0,4,5,8,9,12},{6,7,10,11,13,14},{1,2,3}};
+        vector<vector<int>> g;
+        const int per = 4;
+        for(int c=0;c<N-1;c+=per){
+            g.emplace_back();
+            for(int i=c;i<min(c+per,N-1);i++) g.back().push_back(i);
+        }
+        return g;
+    }
+
+    // Generator: one 0-1 BFS per group over (pattern tile positions, blank position)
+    // seeded from the goal pattern with the blank on any free cell.
+    static bool build(const string &file, const vector<vector<int>> &groups){
+        if(groups.size()>MAXG){ cerr<<"Too many pattern groups\n"; return false; }
+        Header h; memset(&h,0,sizeof h);
+        strcpy(h.magic,"STPDB1"); h.width=W; h.ngroups=groups.size();
+        FILE *f=fopen(file.c_str(),"wb");
+        if(!f){ cerr<<"Cannot open "<<file<<" for writing\n"; return false; }
+        for(size_t g=0;g<groups.size();g++){
+            h.size[g]=groups[g].size();
+            for(size_t i=0;i<groups[g].size();i++) h.cells[g][i]=groups[g][i];
+        }
+        fwrite(&h,sizeof h,1,f);
+        for(size_t g=0;g<groups.size();g++){
+            int k=groups[g].size();
+            vector<uint8_t> dist(perms(N,k+1), 255), table(perms(N,k), 255);
+            vector<uint32_t> cur, next, stack;
+            int pos[N+1];
+            bool in_pattern[N]={};
+            for(int c: groups[g]) in_pattern[c]=true;
+            for(int i=0;i<k;i++) pos[i]=groups[g][i];
+            for(int b=0;b<N;b++) if(!in_pattern[b]){
+                pos[k]=b; uint64_t r=rank_positions(pos,k+1);
+                dist[r]=0; cur.push_back(r);
+            }
+            for(int d=0;!cur.empty();d++){
+                stack.swap(cur); cur.clear(); next.clear();
+                while(!stack.empty()){
+                    uint64_t r=stack.back(); stack.pop_back();
+                    if(dist[r]!=d) continue; // stale entry, already reached cheaper
+                    unrank_positions(r,pos,k+1);
+                    uint64_t tr=rank_positions(pos,k);
+                    if(table[tr]>d) table[tr]=d;
+                    int b=pos[k], br=b/W, bc=b%W;
+                    const int dr[4]={-1,1,0,0}, dc[4]={0,0,-1,1};
+                    for(int m=0;m<4;m++){
+                        int nr=br+dr[m], nc=bc+dc[m];
+                        if(nr<0 || nr>=W || nc<0 || nc>=W) continue;
+                        int nb=nr*W+nc, tile=-1;
+                        for(int i=0;i<k;i++) if(pos[i]==nb){ tile=i; break; }
+                        int cost = tile>=0;
+                        if(tile>=0) pos[tile]=b;
+                        pos[k]=nb;
+                        uint64_t nrk=rank_positions(pos,k+1);
+                        if(dist[nrk]>d+cost){
+                            dist[nrk]=d+cost;
+                            (cost ? next : stack).push_back(nrk);
+                        }
+                        if(tile>=0) pos[tile]=nb;
+                        pos[k]=b;
+                    }
+                }
+                cur.swap(next);
+            }
+            fwrite(table.data(),1,table.size(),f);
+            cerr<<"group "<<g<<" ("<<k<<" tiles): "<<table.size()<<" entries\n";
+        }
+        return fclose(f)==0;
+    }
+
+    // Memory-maps a file written by build(); tables are used in place.
+    bool load(const string &file){
+        int fd=open(file.c_str(),O_RDONLY);
+        if(fd<0){ cerr<<"Cannot open "<<file<<"\n"; return false; }
+        struct stat st;
+        if(fstat(fd,&st)!=0 || size_t(st.st_size)<sizeof(Header)){ close(fd); cerr<<"Bad PDB file\n"; return false; }
+        map_len=st.st_size;
+        map=mmap(nullptr,map_len,PROT_READ,MAP_SHARED,fd,0);
+        close(fd);
+        if(map==MAP_FAILED){ cerr<<"mmap failed for "<<file<<"\n"; return false; }
+        const Header *h=(const Header*)map;
+        if(memcmp(h->magic,"STPDB1",7)!=0 || h->width!=uint32_t(W) || h->ngroups>MAXG){
+            cerr<<"PDB file "<<file<<" is not a "<<W<<"x"<<W<<" pattern database\n"; return false;
+        }
+        // Group sizes and cells come from the file; check them before any
+        // table pointer or lookup depends on them.
+        size_t off=sizeof(Header);
+        for(uint32_t g=0;g<h->ngroups;g++){
+            bool ok = h->size[g]<=uint32_t(N);
+            for(uint32_t i=0;ok && i<h->size[g];i++) ok = h->cells[g][i]<N;
+            if(!ok){ cerr<<"PDB file "<<file<<" has a bad group "<<g<<"\n"; return false; }
+            uint64_t len=perms(N,h->size[g]);
+            if(len>map_len-off){ cerr<<"PDB file "<<file<<" is truncated\n"; return false; }
+            tables[g]=(const uint8_t*)map+off;
+            off+=len;
+        }
+        hdr=h;
+        return true;
+    }
+    int ngroups() const { return hdr ? hdr->ngroups : 0; }
+    // pos_of_cell[i] = current position of the tile whose goal cell is cells[g][i]
+    int lookup(int g, const int *pos_of_goal_cell) const {
+        int pos[N];
+        for(uint32_t i=0;i<hdr->size[g];i++) pos[i]=pos_of_goal_cell[hdr->cells[g][i]];
+        return tables[g][rank_positions(pos,hdr->size[g])];
+    }
+};
+
+// IDA* with Manhattan distance + linear conflict, optionally maxed with an
+// additive pattern database.
+// The board is mutated in place; h is updated incrementally per move by
+// re-scoring only the tile that moved, the two lines it crossed and its PDB group.
+template<int W> struct IdaStar {
+    static const int N = W*W, MAXD = 256;
+    Board<W> board; int blank;
+    int goal_row[N], goal_col[N], goal_pos[N];
+    int pos_of_cell[N]; // current position of the tile whose goal cell is i
+    int md, row_lc[W], col_lc[W];
+    const PatternDB<W> *pdb = nullptr;
+    int group_of_cell[N], pdb_val[PatternDB<W>::MAXG], pdb_sum;
+    int bound, next_bound;
+    long long nodes;
+    int moves[MAXD]; // blank position after each move
+
+    // tiles to remove from a line so the rest are in goal order (len - LIS)
+    int line_conflict(int line, bool is_row) const {
+        int goals[W], n=0;
+        for(int k=0;k<W;k++){
+            int t = board[is_row ? line*W+k : k*W+line];
+            if(t==0) continue;
+            if(is_row ? goal_row[t]==line : goal_col[t]==line)
+                goals[n++] = is_row ? goal_col[t] : goal_row[t];
+        }
+        int lis[W], best=0;
+        for(int i=0;i<n;i++){
+            lis[i]=1;
+            for(int j=0;j<i;j++) if(goals[j]<goals[i]) lis[i]=max(lis[i], lis[j]+1);
+            best=max(best, lis[i]);
+        }
+        return n-best;
+    }
+    int tile_md(int t, int pos) const {
+        return abs(pos/W-goal_row[t]) + abs(pos%W-goal_col[t]);
+    }
+    int h() const {
+        int lc=0;
+        for(int i=0;i<W;i++) lc+=row_lc[i]+col_lc[i];
+        return max(md+2*lc, pdb_sum);
+    }
+    // The PDB is built for the cells of the goal; it only applies if the goal's
+    // blank cell is the one the groups leave uncovered.
+    bool use_pdb(const PatternDB<W> *db, const Board<W> &goal){
+        pdb=nullptr;
+        if(!db) return false;
+        fill(group_of_cell, group_of_cell+N, -1);
+        for(int g=0;g<db->ngroups();g++)
+            for(uint32_t i=0;i<db->hdr->size[g];i++) group_of_cell[db->hdr->cells[g][i]]=g;
+        for(int i=0;i<N;i++) if((group_of_cell[i]<0) != (goal[i]==0)) return false;
+        pdb=db;
+        return true;
+    }
+    void init(const Board<W> &start, const Board<W> &goal){
+        for(int i=0;i<N;i++){ goal_row[goal[i]]=i/W; goal_col[goal[i]]=i%W; goal_pos[goal[i]]=i; }
+        board=start; md=0;
+        for(int i=0;i<N;i++){
+            pos_of_cell[goal_pos[board[i]]]=i;
+            if(board[i]==0) blank=i;
+            else md+=tile_md(board[i], i);
+        }
+        for(int i=0;i<W;i++){ row_lc[i]=line_conflict(i,true); col_lc[i]=line_conflict(i,false); }
+        pdb_sum=0;
+        if(pdb) for(int g=0;g<pdb->ngroups();g++){ pdb_val[g]=pdb->lookup(g,pos_of_cell); pdb_sum+=pdb_val[g]; }
+    }
+    bool dfs(int g, int prev){
+        int f=g+h();
+        if(f>bound){ if(f<next_bound) next_bound=f; return false; }
+        if(md==0) return true;
+        nodes++;
+        const int dr[4]={-1,1,0,0}, dc[4]={0,0,-1,1};
+        int z=blank, r=z/W, c=z%W;
+        for(int k=0;k<4;k++){
+            int nr=r+dr[k], nc=c+dc[k];
+            if(nr<0 || nr>=W || nc<0 || nc>=W) continue;
+            int nz=nr*W+nc;
+            if(nz==prev) continue; // never undo the previous move
+            int t=board[nz], gc=goal_pos[t];
+            int old_md=md, old_a, old_b, old_sum=pdb_sum;
+            md+=tile_md(t,z)-tile_md(t,nz);
+            board[z]=t; board[nz]=0; blank=nz; pos_of_cell[gc]=z;
+            // a vertical move changes the tile's row, a horizontal one its column
+            int *lc = dr[k] ? row_lc : col_lc;
+            int la = dr[k] ? r : c, lb = dr[k] ? nr : nc;
+            old_a=lc[la]; old_b=lc[lb];
+            lc[la]=line_conflict(la, dr[k]!=0); lc[lb]=line_conflict(lb, dr[k]!=0);
+            int grp = pdb ? group_of_cell[gc] : -1, old_val=0;
+            if(grp>=0){
+                old_val=pdb_val[grp];
+                pdb_val[grp]=pdb->lookup(grp,pos_of_cell);
+                pdb_sum+=pdb_val[grp]-old_val;
+            }
+            moves[g]=nz;
+            bool found = g+1<MAXD && dfs(g+1, z);
+            if(grp>=0) pdb_val[grp]=old_val;
+            pdb_sum=old_sum;
+            lc[la]=old_a; lc[lb]=old_b;
+            board[nz]=t; board[z]=0; blank=z; md=old_md; pos_of_cell[gc]=nz;
+            if(found) return true;
+        }
+        return false;
+    }
+    // Fills path with the optimal solution; iter_nodes gets nodes expanded per bound.
+    bool solve(const Board<W> &start, const Board<W> &goal, vector<Board<W>> &path, vector<long long> &iter_nodes){
+        init(start, goal);
+        iter_nodes.clear();
+        for(bound=h(); bound<MAXD; bound=next_bound){
+            next_bound=INT32_MAX; nodes=0;
+            bool found=dfs(0, -1);
+            iter_nodes.push_back(nodes);
+            if(found){
+                // replay the recorded blank moves from the start state
+                path.assign(1, start);
+                Board<W> s=start; int z=0;
+                while(s[z]!=0) z++;
+                for(int i=0;i<bound;i++){ swap(s[z], s[moves[i]]); z=moves[i]; path.push_back(s); }
+                return true;
+            }
+            if(next_bound==INT32_MAX) return false;
+        }
+        return false;
+    }
+};
+
+// Batch mode for the 8-puzzle: answers each start state on stdin from the
+// distance table in file, building and saving it first if it is missing or
+// was built for another goal. Each answer is the blank's moves (U/D/L/R).
+int query_table(const string &file, const State &goal){
+    if(!valid_board<3>(goal)){ cerr<<"Goal must hold 0..8 exactly once\n"; return 1; }
+    DistanceTable table;
+    if(!table.load(file) || table.goal!=goal){
+        auto t0=chrono::steady_clock::now();
+        table.build(goal, max(1u, thread::hardware_concurrency()));
+        auto ms=chrono::duration<double,milli>(chrono::steady_clock::now()-t0).count();
+        cerr<<"Built distance table in "<<ms<<" ms\n";
+        if(!table.save(file)) cerr<<"Could not write "<<file<<"\n";
+    }
+    State start; vector<State> path;
+    string moves;
+    for(int id=1;;id++){
+        for(int i=0;i<9;i++) if(!(cin>>start[i])) return 0;
+        if(!valid_board<3>(start)){ cout<<"#"<<id<<": invalid board\n"; continue; }
+        if(!table.path_to_goal(start, path)){ cout<<"#"<<id<<": not solvable\n"; continue; }
+        moves.clear();
+        for(size_t i=1;i<path.size();i++){
+            int a=find(path[i-1].begin(),path[i-1].end(),0)-path[i-1].begin();
+            int b=find(path[i].begin(),path[i].end(),0)-path[i].begin();
+            moves+= b==a-3 ? 'U' : b==a+3 ? 'D' : b==a-1 ? 'L' : 'R';
+        }
+        cout<<"#"<<id<<": "<<moves.size()<<" moves "<<moves<<"\n";
+    }
+}
+
+// Full state-space sweep from the standard goal with per-level statistics.
+int sweep(int threads){
+    vector<uint8_t> dist;
+    auto t0=chrono::steady_clock::now();
+    auto stats=parallel_bfs(default_goal<3>(), threads, dist);
+    auto ms=chrono::duration<double,milli>(chrono::steady_clock::now()-t0).count();
+    size_t total=0;
+    for(size_t d=0;d<stats.size();d++){
+        cout<<"depth "<<setw(2)<<d<<": "<<setw(6)<<stats[d].frontier<<" states, "<<stats[d].ms<<" ms\n";
+        total+=stats[d].frontier;
+    }
+    cout<<total<<" states in "<<stats.size()<<" levels, "<<ms<<" ms with "<<threads<<" threads\n";
+    return 0;
+}
+
+// Batch mode for larger boards: one start state (W*W numbers) per puzzle on stdin,
+// solved against the standard goal with IDA* over the memory-mapped PDB.
+template<int W> int solve_batch(const string &pdb_file){
+    PatternDB<W> db;
+    if(!db.load(pdb_file)) return 1;
+    Board<W> goal=default_goal<W>(), start;
+    IdaStar<W> ida;
+    if(!ida.use_pdb(&db, goal)){ cerr<<"PDB groups do not match the goal layout\n"; return 1; }
+    vector<Board<W>> path; vector<long long> iter_nodes;
+    for(int id=1;;id++){
+        for(int i=0;i<W*W;i++) if(!(cin>>start[i])) return 0;
+        if(!valid_board<W>(start)){ cout<<"#"<<id<<": invalid board\n"; continue; }
+        if(!solvable<W>(start,goal)){ cout<<"#"<<id<<": not solvable (parity mismatch)\n"; continue; }
+        auto t0=chrono::steady_clock::now();
+        bool ok=ida.solve(start,goal,path,iter_nodes);
+        auto ms=chrono::duration<double,milli>(chrono::steady_clock::now()-t0).count();
+        long long total=0; for(long long n: iter_nodes) total+=n;
+        if(ok) cout<<"#"<<id<<": "<<path.size()-1<<" moves, "<<total<<" nodes, "<<ms<<" ms\n";
+        else cout<<"#"<<id<<": no solution found\n";
+    }
+}
+template<int W> int build_pdb(const string &file){
+    return PatternDB<W>::build(file, PatternDB<W>::default_groups()) ? 0 : 1;
 }
 
-int main(){
+int main(int argc, char **argv){
     ios::sync_with_stdio(false);
     cin.tie(nullptr);
+    // Usage: a1 [bfs|bibfs|ida|all]     8-puzzle, interactive (default: all)
+    //        a1 table <file> [goal]     answer 8-puzzles from stdin via a distance table
+    //        a1 sweep [threads]         parallel BFS over the whole 8-puzzle space
+    //        a1 build-pdb <W> <file>    generate pattern databases for a WxW board
+    //        a1 solve <W> <file>        solve WxW puzzles from stdin using that file
+    string mode = argc>1 ? argv[1] : "all";
+    if((mode=="build-pdb" || mode=="solve") && argc==4){
+        int w=atoi(argv[2]);
+        bool build = mode=="build-pdb";
+        if(w==3) return build ? build_pdb<3>(argv[3]) : solve_batch<3>(argv[3]);
+        if(w==4) return build ? build_pdb<4>(argv[3]) : solve_batch<4>(argv[3]);
+        if(w==5) return build ? build_pdb<5>(argv[3]) : solve_batch<5>(argv[3]);
+        cout<<"Board width must be 3, 4 or 5.\n"; return 1;
+    }
+    if(mode=="sweep" && argc<=3){
+        int threads = argc==3 ? atoi(argv[2]) : int(thread::hardware_concurrency());
+        return sweep(max(1, threads));
+    }
+    if(mode=="table" && (argc==3 || argc==12)){
+        State goal=default_goal<3>();
+        if(argc==12) for(int i=0;i<9;i++) goal[i]=atoi(argv[3+i]);
+        return query_table(argv[2], goal);
+    }
+    if(mode!="bfs" && mode!="bibfs" && mode!="ida" && mode!="all"){
+        cout<<"Usage: "<<argv[0]<<" [bfs|bibfs|ida|all] | table <file> [goal] | sweep [threads] | build-pdb <W> <file> | solve <W> <file>\n"; return 1;
+    }
     // Example usage:
     // Input 9 integers for start, optional 9 integers for goal.
     // Example start: 1 2 3 4 0 6 7 5 8
@@ -119,23 +691,55 @@ int main(){
         if(!(cin>>goal[i])) { haveGoal=false; break;}
     }
     if(!haveGoal){
-        goal = {1,2,3,4,5,6,7,8,0};
+        goal = default_goal<3>();
+    }
+    if(!valid_board<3>(start) || !valid_board<3>(goal)){
+        cout<<"Start and goal must each hold 0..8 exactly once.\n"; return 1;
     }
-    if(!solvable(start,goal)){
+    if(!solvable<3>(start,goal)){
         cout<<"This puzzle is not solvable (parity mismatch).\n"; return 0;
     }
 
     vector<State> path;
-    cout<<"\nRunning BFS (shortest path)...\n";
-    if(bfs_solve(start,goal,path)){
-        cout<<"Solved in "<<path.size()-1<<" moves.\n";
-        for(auto &s: path){ print_state(s); }
-    } else cout<<"BFS could not find solution within memory limits.\n";
-
-    cout<<"\nRunning IDDFS (depth-limited DFS)…\n";
-    if(iddfs_solve(start,goal,path,30)){
-        cout<<"Solved in "<<path.size()-1<<" moves (IDDFS).\n";
-        for(auto &s: path){ print_state(s); }
-    } else cout<<"IDDFS failed up to depth 30.\n";
+    if(mode=="bfs" || mode=="all"){
+        cout<<"\nRunning BFS (shortest path)...\n";
+        size_t expanded=0;
+        auto t0=chrono::steady_clock::now();
+        bool ok=bfs_solve(start,goal,path,&expanded);
+        auto us=chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now()-t0).count();
+        if(ok){
+            cout<<"Solved in "<<path.size()-1<<" moves ("<<expanded<<" nodes expanded, "<<us<<" us).\n";
+            for(auto &s: path){ print_state<3>(s); }
+        } else cout<<"BFS could not find solution within memory limits.\n";
+    }
+
+    if(mode=="bibfs" || mode=="all"){
+        cout<<"\nRunning bidirectional BFS (shortest path)...\n";
+        size_t expanded=0;
+        auto t0=chrono::steady_clock::now();
+        bool ok=bibfs_solve(start,goal,path,&expanded);
+        auto us=chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now()-t0).count();
+        if(ok){
+            cout<<"Solved in "<<path.size()-1<<" moves ("<<expanded<<" nodes expanded, "<<us<<" us).\n";
+            for(auto &s: path){ print_state<3>(s); }
+        } else cout<<"Bidirectional BFS could not find solution within memory limits.\n";
+    }
+
+    if(mode=="ida" || mode=="all"){
+        cout<<"\nRunning IDA* (Manhattan + linear conflict)...\n";
+        IdaStar<3> ida; vector<long long> iter_nodes;
+        auto t0=chrono::steady_clock::now();
+        bool ok=ida.solve(start,goal,path,iter_nodes);
+        auto us=chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now()-t0).count();
+        long long total=0;
+        for(size_t i=0;i<iter_nodes.size();i++){
+            cout<<"  iteration "<<i+1<<": "<<iter_nodes[i]<<" nodes expanded\n";
+            total+=iter_nodes[i];
+        }
+        if(ok){
+            cout<<"Solved in "<<path.size()-1<<" moves (IDA*, "<<total<<" nodes expanded, "<<us<<" us).\n";
+            for(auto &s: path){ print_state<3>(s); }
+        } else cout<<"IDA* found no solution.\n";
+    }
     return 0;
 }
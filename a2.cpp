@@ -2,93 +2,579 @@
 #include <iostream>
 #include <vector>
 #include <string>
-#include <unordered_map>
-#include <unordered_set>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <cstdint>
 using namespace std;
 
 /*
-Simple CSP solver with backtracking + forward checking.
-Example solves Australia map coloring with 3 colors.
+Graph-coloring CSP solver: backtracking with maintained arc consistency (or
+plain forward checking), MRV + degree variable ordering and least-constraining
+value ordering.
+Without a graph it solves the Australia map with 3 colors; otherwise
+    a2 <graph.col> <colors> [mac|fc] [--threads T] [--count] [--portfolio] [--learn]
+loads a DIMACS edge-format graph ("p edge N M", "e u v" lines).
+--count enumerates all colorings instead of stopping at the first one.
+With --threads the tree is split into subtrees that T workers pull from
+work-stealing queues; --portfolio instead runs T differently seeded value
+orderings on the whole problem and keeps the first to finish.
+--learn switches the find-one search (sequential or portfolio) to conflict-
+directed backjumping with nogood learning and Luby restarts.
+
+Variables are dense integer IDs with their own adjacency lists, each domain is
+a bitmask over the value indices (so at most 64 values), and every domain
+change is recorded on a trail so backtracking undoes it instead of copying
+the domains.
 */
 
-using Var = string;
-using Domain = vector<string>;
-using Assignment = unordered_map<Var, string>;
+using Domain = uint64_t;
+
+struct CSP {
+    vector<string> names;       // variable id -> name
+    vector<string> values;      // value index -> name
+    vector<vector<int>> adj;    // variable id -> neighbor ids (must differ)
 
-vector<pair<Var, Var>> neighbors = {
-    {"WA","NT"},{"WA","SA"},{"NT","SA"},{"NT","Q"},{"SA","Q"},{"SA","NSW"},
-    {"SA","V"},{"Q","NSW"},{"NSW","V"}
+    int add_var(const string &name){
+        names.push_back(name); adj.emplace_back();
+        return (int)names.size()-1;
+    }
+    void add_constraint(int a, int b){
+        adj[a].push_back(b); adj[b].push_back(a);
+    }
+    int size() const { return (int)names.size(); }
+    Domain full_domain() const {
+        return values.size()>=64 ? ~Domain(0) : (Domain(1)<<values.size())-1;
+    }
 };
 
-vector<Var> variables = {"WA","NT","SA","Q","NSW","V","T"};
+struct Lit { int var, val; };           // var == val
+struct Nogood { vector<Lit> lits; int activity=0; }; // literals that cannot all hold
 
-unordered_map<Var, Domain> init_domains(){
-    Domain colors = {"red","green","blue"};
-    unordered_map<Var, Domain> d;
-    for(auto &v: variables) d[v]=colors;
-    return d;
-}
+struct Solver {
+    struct TrailEntry {
+        int var; Domain old;
+        int level;      // decision level the change was made at
+        int reason;     // >=0: that neighbor was fixed to the removed value,
+                        // -1: decision, <=-2: nogood -reason-2 became unit
+        int prev;       // previous entry for the same variable, -1 if none
+    };
+    const CSP &csp;
+    vector<Domain> dom;
+    vector<int> assign;                 // value index, -1 if unassigned
+    vector<TrailEntry> trail;           // every domain change, newest last
+    vector<int> last;                   // newest trail entry per variable
+    vector<int> queue;                  // propagation queue of singleton variables
+    int assigned = 0;
+    bool mac = true;
+    long long nodes = 0;
+    const atomic<bool> *stop = nullptr; // set by another thread to cancel the search
+    bool randomize = false;             // seeded random value order instead of LCV
+    mt19937 rng;
+
+    // conflict-directed search state (solve_learning)
+    bool learning = false;
+    int level = 0;
+    vector<int> dec_var, dec_val, level_start; // per decision level
+    vector<int> phase;                  // last value decided per variable, -1 if none
+    vector<double> weight;              // degree + times involved in a conflict
+    vector<Nogood> nogoods;
+    vector<vector<int>> watches;        // literal var*K+val -> nogoods watching it
+    size_t max_nogoods = 20000;
+    int conflict_var = -1, conflict_nogood = -1;
+    long long conflicts = 0, restarts = 0;
+
+    explicit Solver(const CSP &c): csp(c), dom(c.size(), c.full_domain()), assign(c.size(), -1), last(c.size(), -1) {}
 
-bool consistent(const Var &v, const string &val, const Assignment &assign){
-    for(auto &p: neighbors){
-        if(p.first==v){
-            auto it=assign.find(p.second);
-            if(it!=assign.end() && it->second==val) return false;
-        } else if(p.second==v){
-            auto it=assign.find(p.first);
-            if(it!=assign.end() && it->second==val) return false;
+    void set_domain(int v, Domain d, int reason=-1){
+        trail.push_back({v, dom[v], level, reason, last[v]});
+        last[v]=trail.size()-1;
+        dom[v]=d;
+    }
+    void undo_to(size_t mark){
+        while(trail.size()>mark){
+            auto &e=trail.back();
+            dom[e.var]=e.old; last[e.var]=e.prev;
+            trail.pop_back();
         }
     }
-    return true;
+    // AC-3 specialised to "differ" constraints: an arc (x,y) can only lose
+    // support once y is down to a single value, so the queue holds variables
+    // that just became singletons and revising removes that value from each
+    // neighbor. Without MAC only the assigned variable's neighbors are revised
+    // (forward checking). Returns false on a domain wipe-out.
+    bool propagate(int var){
+        queue.clear(); queue.push_back(var);
+        for(size_t qi=0; qi<queue.size(); qi++){
+            int y=queue[qi];
+            Domain bit=dom[y];
+            for(int x: csp.adj[y]){
+                if(!(dom[x]&bit)) continue;
+                set_domain(x, dom[x]&~bit, y);
+                if(!dom[x]){ conflict_var=x; return false; }
+                if(mac && assign[x]<0 && !(dom[x]&(dom[x]-1))) queue.push_back(x);
+            }
+            if(learning && !propagate_nogoods(y)) return false;
+        }
+        return true;
+    }
+
+    // Nogoods watch two literals that are not yet true (variable fixed to that
+    // value). When a watched literal becomes true the nogood looks for another
+    // one to watch; failing that, the other watched literal is made false, or
+    // the nogood is violated if it is already true.
+    bool lit_true(Lit l) const { return dom[l.var]==Domain(1)<<l.val; }
+    bool lit_false(Lit l) const { return !(dom[l.var]>>l.val&1); }
+    int lit_index(Lit l) const { return l.var*(int)csp.values.size()+l.val; }
+    bool propagate_nogoods(int y){
+        Lit fixed{y, __builtin_ctzll(dom[y])};
+        auto &ws=watches[lit_index(fixed)];
+        size_t i=0, j=0;
+        bool ok=true;
+        for(; i<ws.size(); i++){
+            int g=ws[i];
+            auto &lits=nogoods[g].lits;
+            if(lits[0].var==y) swap(lits[0], lits[1]); // lits[1] is the literal that became true
+            if(lit_false(lits[0])){ ws[j++]=g; continue; }
+            size_t k=2;
+            while(k<lits.size() && lit_true(lits[k])) k++;
+            if(k<lits.size()){
+                swap(lits[1], lits[k]);
+                watches[lit_index(lits[1])].push_back(g);
+                continue;
+            }
+            ws[j++]=g;
+            if(lit_true(lits[0])){ conflict_nogood=g; ok=false; i++; break; }
+            int z=lits[0].var;
+            set_domain(z, dom[z]&~(Domain(1)<<lits[0].val), -2-g);
+            if(!dom[z]){ conflict_var=z; ok=false; i++; break; }
+            if(!(dom[z]&(dom[z]-1))) queue.push_back(z);
+        }
+        while(i<ws.size()) ws[j++]=ws[i++];
+        ws.resize(j);
+        return ok;
+    }
+    int unassigned_degree(int v) const {
+        int d=0;
+        for(int nb: csp.adj[v]) d+= assign[nb]<0;
+        return d;
+    }
+    // MRV, ties broken by the number of unassigned neighbors
+    int select_var() const {
+        // conflict-directed search ranks by domain size / conflict weight (dom/wdeg)
+        if(learning){
+            int sel=-1; double best=1e300;
+            for(int v=0;v<csp.size();v++) if(assign[v]<0){
+                double score=__builtin_popcountll(dom[v])/weight[v];
+                if(score<best){ best=score; sel=v; }
+            }
+            return sel;
+        }
+        int sel=-1, best=65, best_deg=-1;
+        for(int v=0;v<csp.size();v++) if(assign[v]<0){
+            int sz=__builtin_popcountll(dom[v]);
+            if(sz>best) continue;
+            int deg=unassigned_degree(v);
+            if(sz<best || deg>best_deg){ best=sz; best_deg=deg; sel=v; }
+        }
+        return sel;
+    }
+    // least-constraining value first: fewest unassigned neighbors that still allow it
+    int order_values(int v, int *out){
+        int n=0, cost[64];
+        for(Domain d=dom[v]; d; d&=d-1){
+            int val=__builtin_ctzll(d);
+            cost[val]=0;
+            for(int nb: csp.adj[v]) if(assign[nb]<0 && (dom[nb]>>val&1)) cost[val]++;
+            if(randomize) cost[val]=int(rng()%1024);
+            out[n++]=val;
+        }
+        stable_sort(out, out+n, [&](int a,int b){ return cost[a]<cost[b]; });
+        return n;
+    }
+    // assign and propagate; on failure the caller still undoes to its mark
+    bool assign_value(int var, int val){
+        assign[var]=val; assigned++;
+        set_domain(var, Domain(1)<<val);
+        return propagate(var);
+    }
+    void unassign(int var, size_t mark){
+        undo_to(mark);
+        assign[var]=-1; assigned--;
+    }
+    bool backtrack(){
+        if(assigned==csp.size()) return true;
+        if(stop && stop->load(memory_order_relaxed)) return false;
+        nodes++;
+        int sel=select_var();
+        if(sel<0) return false;
+        int vals[64], n=order_values(sel, vals);
+        for(int i=0;i<n;i++){
+            size_t mark=trail.size();
+            if(assign_value(sel, vals[i]) && backtrack()) return true;
+            // restore
+            unassign(sel, mark);
+        }
+        return false;
+    }
+    // number of complete assignments below the current node
+    long long count_solutions(){
+        if(assigned==csp.size()) return 1;
+        if(stop && stop->load(memory_order_relaxed)) return 0;
+        nodes++;
+        int sel=select_var();
+        long long total=0;
+        for(Domain d=dom[sel]; d; d&=d-1){
+            size_t mark=trail.size();
+            if(assign_value(sel, __builtin_ctzll(d))) total+=count_solutions();
+            unassign(sel, mark);
+        }
+        return total;
+    }
+
+    // Decision levels behind the current conflict: walks the reasons of the
+    // removals involved back to the decisions that caused them (the conflict
+    // set of the failed variable, accumulated through propagation). Every
+    // variable on the way gains conflict weight. Level-0 removals hold
+    // globally and are never explained.
+    vector<int> seen;
+    int seen_stamp = 0;
+    void analyze(vector<int> &levels){
+        if(seen.size()<trail.size()) seen.resize(trail.size()*2, 0);
+        seen_stamp++;
+        vector<char> in_set(level+1, 0);
+        vector<int> &stack=queue;
+        stack.clear();
+        // entries of v older than `before`
+        auto push_var=[&](int v, int before){
+            for(int e=last[v]; e>=0; e=trail[e].prev)
+                if(e<before && seen[e]!=seen_stamp){ seen[e]=seen_stamp; stack.push_back(e); }
+        };
+        if(conflict_nogood>=0){
+            nogoods[conflict_nogood].activity++;
+            for(Lit l: nogoods[conflict_nogood].lits) push_var(l.var, trail.size());
+        } else push_var(conflict_var, trail.size());
+        while(!stack.empty()){
+            int e=stack.back(); stack.pop_back();
+            const TrailEntry &t=trail[e];
+            if(t.level==0) continue;
+            weight[t.var]+=1;
+            if(t.reason==-1) in_set[t.level]=1;
+            else if(t.reason>=0) push_var(t.reason, e);
+            else {
+                Nogood &ng=nogoods[-t.reason-2];
+                ng.activity++;
+                for(Lit l: ng.lits) if(l.var!=t.var) push_var(l.var, e);
+            }
+        }
+        levels.clear();
+        for(int l=1;l<=level;l++) if(in_set[l]) levels.push_back(l);
+        conflict_var=conflict_nogood=-1;
+    }
+    void backjump(int target){
+        for(int l=level;l>target;l--){ assign[dec_var[l]]=-1; assigned--; }
+        undo_to(level_start[target+1]);
+        level=target;
+        dec_var.resize(level+1); dec_val.resize(level+1); level_start.resize(level+1);
+    }
+    // Adds the nogood "not all of these decisions" after backjumping below its
+    // newest decision (lits[0]), and propagates it: that decision's value is
+    // removed. Returns false on a new conflict.
+    bool learn(const vector<int> &levels){
+        Nogood ng;
+        for(int i=levels.size()-1;i>=0;i--) ng.lits.push_back({dec_var[levels[i]], dec_val[levels[i]]});
+        Lit unit=ng.lits[0];
+        int g=-1;
+        if(ng.lits.size()>1){
+            g=nogoods.size();
+            nogoods.push_back(move(ng));
+            watches[lit_index(nogoods[g].lits[0])].push_back(g);
+            watches[lit_index(nogoods[g].lits[1])].push_back(g);
+        }
+        // a single-literal nogood needs no watches: the value is gone for good
+        Domain bit=Domain(1)<<unit.val;
+        if(!(dom[unit.var]&bit)) return true;
+        set_domain(unit.var, dom[unit.var]&~bit, g>=0 ? -2-g : -1);
+        if(!dom[unit.var]){ conflict_var=unit.var; return false; }
+        if(!(dom[unit.var]&(dom[unit.var]-1))) return propagate(unit.var);
+        return true;
+    }
+    // Keeps the most active half of the learned nogoods plus all binary ones.
+    // Only called at level 0, where no surviving reason refers to a nogood.
+    void reduce_nogoods(){
+        if(nogoods.size()<=max_nogoods) return;
+        vector<int> order(nogoods.size());
+        for(size_t i=0;i<order.size();i++) order[i]=i;
+        sort(order.begin(), order.end(), [&](int a,int b){ return nogoods[a].activity>nogoods[b].activity; });
+        vector<Nogood> kept;
+        for(size_t r=0;r<order.size();r++){
+            Nogood &ng=nogoods[order[r]];
+            if(r<max_nogoods/2 || ng.lits.size()<=2){ ng.activity/=2; kept.push_back(move(ng)); }
+        }
+        nogoods.swap(kept);
+        for(auto &w: watches) w.clear();
+        for(size_t g=0;g<nogoods.size();g++){
+            watches[lit_index(nogoods[g].lits[0])].push_back(g);
+            watches[lit_index(nogoods[g].lits[1])].push_back(g);
+        }
+    }
+    // 1,1,2,1,1,2,4,1,1,2,1,1,2,4,8,...
+    static long long luby(long long i){
+        int k=1;
+        while((1LL<<k)-1<i) k++;
+        if(i==(1LL<<k)-1) return 1LL<<(k-1);
+        return luby(i-(1LL<<(k-1))+1);
+    }
+    // Iterative search with conflict-directed backjumping: a conflict is traced
+    // to the decisions responsible, recorded as a nogood, and the search jumps
+    // back to the newest of the other responsible decisions instead of the
+    // previous level. Restarts follow a Luby schedule (in units of
+    // restart_base conflicts) and re-use each variable's last decided value.
+    // Returns 1 if a solution was found, 0 if none exists, -1 if stopped.
+    int solve_learning(int restart_base=100){
+        learning=true;
+        watches.assign(csp.size()*csp.values.size(), {});
+        phase.assign(csp.size(), -1);
+        weight.resize(csp.size());
+        for(int v=0;v<csp.size();v++) weight[v]=csp.adj[v].size()+1;
+        dec_var.assign(1,-1); dec_val.assign(1,-1); level_start.assign(1,0);
+        long long next_restart=restart_base*luby(1);
+        vector<int> levels;
+        for(;;){
+            if(stop && stop->load(memory_order_relaxed)) return -1;
+            if(assigned==csp.size()) return 1;
+            if(conflicts>=next_restart){
+                restarts++;
+                backjump(0);
+                reduce_nogoods();
+                next_restart=conflicts+restart_base*luby(restarts+1);
+            }
+            nodes++;
+            int var=select_var(), val;
+            if(phase[var]>=0 && (dom[var]>>phase[var]&1)) val=phase[var];
+            else { int vals[64]; order_values(var, vals); val=vals[0]; }
+            phase[var]=val;
+            level++;
+            dec_var.push_back(var); dec_val.push_back(val); level_start.push_back(trail.size());
+            bool ok=assign_value(var, val);
+            while(!ok){
+                conflicts++;
+                analyze(levels);
+                if(levels.empty()) return 0; // conflict independent of any decision
+                backjump(levels.size()>1 ? levels[levels.size()-2] : 0);
+                ok=learn(levels);
+            }
+        }
+    }
+    // Enumerates the consistent decision prefixes `depth` levels down; their
+    // subtrees partition the remaining search space.
+    void split(int depth, vector<pair<int,int>> &prefix, vector<vector<pair<int,int>>> &tasks){
+        if(depth==0 || assigned==csp.size()){ tasks.push_back(prefix); return; }
+        int sel=select_var();
+        for(Domain d=dom[sel]; d; d&=d-1){
+            int val=__builtin_ctzll(d);
+            size_t mark=trail.size();
+            if(assign_value(sel, val)){
+                prefix.push_back({sel, val});
+                split(depth-1, prefix, tasks);
+                prefix.pop_back();
+            }
+            unassign(sel, mark);
+        }
+    }
+};
+
+struct ThreadStats { long long nodes=0; double ms=0; int tasks=0, stolen=0; };
+
+// Work-stealing parallel search. The tree is cut into at least 8 subtrees per
+// thread; each worker owns a deque of them, takes work from its back and, when
+// empty, steals from the front of another worker's deque. Every worker keeps
+// its own Solver, so domain state and trail are thread-local. In find-one mode
+// the first solution cancels everyone; otherwise subtree counts are summed.
+long long parallel_search(const CSP &csp, bool mac, bool count_all, int threads,
+                          vector<int> &solution, vector<ThreadStats> &stats){
+    vector<vector<pair<int,int>>> tasks;
+    {
+        Solver root(csp); root.mac=mac;
+        vector<pair<int,int>> prefix;
+        // Deepen until there are enough subtrees. Levels forced to one value
+        // by propagation do not grow the count, so keep going through them;
+        // stop early only when pruning leaves nothing to split.
+        for(int depth=1; depth<=csp.size(); depth++){
+            tasks.clear();
+            root.split(depth, prefix, tasks);
+            if(tasks.empty() || tasks.size()>=size_t(threads)*8) break;
+        }
+    }
+    struct TaskQueue { mutex m; deque<int> q; };
+    vector<TaskQueue> queues(threads);
+    for(size_t i=0;i<tasks.size();i++) queues[i%threads].q.push_back(i);
+
+    atomic<bool> stop(false);
+    atomic<long long> found(0);
+    mutex solution_mutex;
+    stats.assign(threads, ThreadStats());
+    auto take=[&](int id, int &task)->bool{
+        for(int k=0;k<threads;k++){
+            TaskQueue &tq=queues[(id+k)%threads];
+            lock_guard<mutex> lk(tq.m);
+            if(tq.q.empty()) continue;
+            if(k==0){ task=tq.q.back(); tq.q.pop_back(); }
+            else { task=tq.q.front(); tq.q.pop_front(); stats[id].stolen++; }
+            return true;
+        }
+        return false;
+    };
+    auto worker=[&](int id){
+        auto t0=chrono::steady_clock::now();
+        Solver s(csp); s.mac=mac; s.stop=&stop;
+        int task;
+        while(!stop.load(memory_order_relaxed) && take(id, task)){
+            stats[id].tasks++;
+            bool ok=true;
+            for(auto &d: tasks[task]) if(!s.assign_value(d.first, d.second)){ ok=false; break; }
+            if(ok){
+                if(count_all) found+=s.count_solutions();
+                else if(s.backtrack() && !stop.exchange(true)){
+                    lock_guard<mutex> lk(solution_mutex);
+                    solution=s.assign; found=1;
+                }
+            }
+            // rewind to the root for the next task
+            s.undo_to(0);
+            fill(s.assign.begin(), s.assign.end(), -1); s.assigned=0;
+        }
+        stats[id].nodes=s.nodes;
+        stats[id].ms=chrono::duration<double,milli>(chrono::steady_clock::now()-t0).count();
+    };
+    vector<thread> pool;
+    for(int i=0;i<threads;i++) pool.emplace_back(worker, i);
+    for(auto &t: pool) t.join();
+    return found;
+}
+
+// Portfolio: every worker searches the whole problem with its own value-order
+// seed (worker 0 keeps the LCV order); the first one done cancels the rest.
+bool portfolio_search(const CSP &csp, bool mac, bool learning, int threads, vector<int> &solution, vector<ThreadStats> &stats){
+    atomic<bool> stop(false);
+    bool solved=false;
+    mutex solution_mutex;
+    stats.assign(threads, ThreadStats());
+    auto worker=[&](int id){
+        auto t0=chrono::steady_clock::now();
+        Solver s(csp); s.mac=mac; s.stop=&stop;
+        s.randomize = id>0; s.rng.seed(id);
+        int res = learning ? s.solve_learning() : s.backtrack();
+        if(res<0) res=0;
+        bool ok=res;
+        // an exhausted tree also settles the question (no coloring exists)
+        if(!stop.exchange(true)){
+            lock_guard<mutex> lk(solution_mutex);
+            solved=ok;
+            if(ok) solution=s.assign;
+        }
+        stats[id].tasks=1;
+        stats[id].nodes=s.nodes;
+        stats[id].ms=chrono::duration<double,milli>(chrono::steady_clock::now()-t0).count();
+    };
+    vector<thread> pool;
+    for(int i=0;i<threads;i++) pool.emplace_back(worker, i);
+    for(auto &t: pool) t.join();
+    return solved;
 }
 
-bool forward_check(const Var &var, const string &val, unordered_map<Var, Domain> &domains, const Assignment &assign){
-    // reduce domains for neighbors; return false if some domain becomes empty
-    for(auto &p: neighbors){
-        Var nb="";
-        if(p.first==var) nb=p.second;
-        else if(p.second==var) nb=p.first;
-        if(nb=="") continue;
-        if(assign.count(nb)) continue;
-        auto &dom = domains[nb];
-        size_t before = dom.size();
-        dom.erase(remove(dom.begin(), dom.end(), val), dom.end());
-        if(dom.empty()) return false;
+// DIMACS edge format; vertices are named by their 1-based number and the
+// colors by 1..k. Duplicate and self edges are dropped.
+bool load_dimacs(const string &file, int k, CSP &csp){
+    ifstream in(file);
+    if(!in){ cerr<<"Cannot open "<<file<<"\n"; return false; }
+    if(k<1 || k>64){ cerr<<"Number of colors must be between 1 and 64\n"; return false; }
+    string line;
+    while(getline(in,line)){
+        if(line.empty() || line[0]=='c') continue;
+        istringstream iss(line);
+        char kind; iss>>kind;
+        if(kind=='p'){
+            string fmt; int n=0; iss>>fmt>>n;
+            for(int i=1;i<=n;i++) csp.add_var(to_string(i));
+        } else if(kind=='e'){
+            int u,v;
+            if(!(iss>>u>>v) || u<1 || v<1 || u>csp.size() || v>csp.size()){
+                cerr<<"Bad edge line: "<<line<<"\n"; return false;
+            }
+            if(u!=v) csp.add_constraint(u-1, v-1);
+        }
     }
+    for(auto &a: csp.adj){ sort(a.begin(),a.end()); a.erase(unique(a.begin(),a.end()),a.end()); }
+    for(int c=1;c<=k;c++) csp.values.push_back(to_string(c));
     return true;
 }
 
-bool backtrack(Assignment &assign, unordered_map<Var, Domain> &domains){
-    if(assign.size()==variables.size()) return true;
-    // MRV heuristic
-    Var sel="";
-    size_t best = SIZE_MAX;
-    for(auto &v: variables) if(!assign.count(v)){
-        if(domains[v].size() < best){ best = domains[v].size(); sel=v; }
-    }
-    if(sel=="") return false;
-    Domain domain_copy = domains[sel];
-    for(auto &val: domain_copy){
-        if(!consistent(sel,val,assign)) continue;
-        // save domains snapshot
-        auto saved = domains;
-        assign[sel]=val;
-        bool ok = forward_check(sel,val,domains,assign);
-        if(ok && backtrack(assign,domains)) return true;
-        // restore
-        domains = saved;
-        assign.erase(sel);
-    }
-    return false;
+CSP australia(){
+    CSP csp;
+    csp.values = {"red","green","blue"};
+    for(const char *v: {"WA","NT","SA","Q","NSW","V","T"}) csp.add_var(v);
+    const int edges[][2] = {{0,1},{0,2},{1,2},{1,3},{2,3},{2,4},{2,5},{3,4},{4,5}};
+    for(auto &e: edges) csp.add_constraint(e[0], e[1]);
+    return csp;
 }
 
-int main(){
-    auto domains = init_domains();
-    Assignment assign;
-    bool solved = backtrack(assign, domains);
-    if(solved){
+int main(int argc, char **argv){
+    vector<string> pos;
+    int threads=0;
+    bool count_all=false, portfolio=false, learning=false;
+    for(int i=1;i<argc;i++){
+        string a=argv[i];
+        if(a=="--threads" && i+1<argc) threads=atoi(argv[++i]);
+        else if(a=="--count") count_all=true;
+        else if(a=="--portfolio") portfolio=true;
+        else if(a=="--learn") learning=true;
+        else pos.push_back(a);
+    }
+    CSP csp;
+    if(pos.size()>=2){
+        if(!load_dimacs(pos[0], atoi(pos[1].c_str()), csp)) return 1;
+    } else csp = australia();
+    bool mac = !(pos.size()>=3 && pos[2]=="fc");
+    if(portfolio && threads<1) threads=thread::hardware_concurrency();
+    if(portfolio && count_all){ cerr<<"--portfolio only applies to finding one solution\n"; return 1; }
+    if(learning && (count_all || (threads>0 && !portfolio))){
+        cerr<<"--learn only applies to the sequential and portfolio find-one searches\n"; return 1;
+    }
+
+    vector<int> solution;
+    vector<ThreadStats> stats;
+    long long found=0, nodes=0;
+    auto t0=chrono::steady_clock::now();
+    if(portfolio){
+        found=portfolio_search(csp, mac, learning, max(1,threads), solution, stats);
+    } else if(threads>0){
+        found=parallel_search(csp, mac, count_all, threads, solution, stats);
+    } else {
+        Solver solver(csp); solver.mac=mac;
+        if(count_all) found=solver.count_solutions();
+        else if(learning ? solver.solve_learning()==1 : solver.backtrack()){ found=1; solution=solver.assign; }
+        nodes=solver.nodes;
+        if(learning) cerr<<solver.conflicts<<" conflicts, "<<solver.restarts<<" restarts, "<<solver.nogoods.size()<<" nogoods kept\n";
+    }
+    double ms=chrono::duration<double,milli>(chrono::steady_clock::now()-t0).count();
+    if(count_all){
+        cout<<found<<" solutions\n";
+    } else if(found){
         cout<<"Solution:\n";
-        for(auto &v: variables) cout<<v<<": "<<assign[v]<<"\n";
+        for(int v=0;v<csp.size();v++) cout<<csp.names[v]<<": "<<csp.values[solution[v]]<<"\n";
     } else cout<<"No solution found\n";
+    for(size_t i=0;i<stats.size();i++){
+        nodes+=stats[i].nodes;
+        cerr<<"thread "<<i<<": "<<stats[i].nodes<<" nodes, "<<stats[i].tasks<<" tasks ("<<stats[i].stolen<<" stolen), "
+            <<(stats[i].ms>0 ? stats[i].nodes/stats[i].ms*1000 : 0)<<" nodes/s\n";
+    }
+    cerr<<nodes<<" nodes, "<<ms<<" ms ("<<(mac?"MAC":"forward checking")<<")\n";
     return 0;
 }
@@ -1,10 +1,22 @@
 // family_kb.cpp
 #include <iostream>
-#include <sstream>
 #include <vector>
+#include <deque>
 #include <unordered_map>
-#include <unordered_set>
 #include <string>
+#include <string_view>
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 using namespace std;
 
 /*
@@ -18,6 +30,11 @@ is_parent A B
 is_grandparent A C
 is_sibling X Y
 is_ancestor A D
+is_cousin A B K        (K-th cousins; K defaults to 1)
+common_ancestor A B    (nearest shared ancestor, or NONE)
+generation_gap A B     (generations from A down to B via their nearest shared
+                        ancestor, e.g. 2 for grandparent, 0 for cousins)
+More "parent A B" facts may still be given between queries.
 Type "exit" to stop.
 
 parent John Mary
@@ -39,66 +56,771 @@ is_ancestor Mary David
 is_ancestor Alex David
 exit
 
+Large fact files can be bulk-loaded and saved as a snapshot instead:
+  a3 load facts.txt [kb.snap] [--threads T]   parse in parallel, then queries
+  a3 open kb.snap                             map a saved snapshot, then queries
+
 */
 
-unordered_map<string, vector<string>> children_of;
-unordered_map<string, vector<string>> parents_of;
+// A read-only array that owns its elements or views a mapped snapshot.
+template<class T> struct Column {
+    vector<T> own;
+    const T *p = nullptr;
+    size_t n = 0;
+    void adopt(vector<T> &&v){ own=move(v); p=own.data(); n=own.size(); }
+    void view(const T *q, size_t m){ own.clear(); p=q; n=m; }
+    const T& operator[](size_t i) const { return p[i]; }
+    const T *begin() const { return p; }
+    const T *end() const { return p+n; }
+    size_t size() const { return n; }
+};
 
-bool is_parent(const string &a,const string &b){
-    for(auto &c: children_of[a]) if(c==b) return true;
-    return false;
-}
-bool is_grandparent(const string &a,const string &b){
-    for(auto &c: children_of[a]) if(is_parent(c,b)) return true;
-    return false;
-}
-bool is_sibling(const string &a,const string &b){
-    if(a==b) return false;
-    for(auto &p: parents_of[a]) for(auto &q: parents_of[b]) if(p==q) return true;
-    return false;
-}
-bool is_ancestor(const string &a,const string &b, unordered_set<string> &visited){
-    if(is_parent(a,b)) return true;
-    for(auto &c: children_of[a]){
-        if(visited.count(c)) continue;
-        visited.insert(c);
-        if(is_ancestor(c,b,visited)) return true;
-    }
-    return false;
+// Names are interned to dense IDs while facts are loaded; freeze() then packs
+// the names into one string table with an open-addressing hash, the edges into
+// CSR arrays with sorted adjacency, and builds the reachability index. Queries
+// only read the graph, so answering one allocates nothing. Facts that arrive
+// after freeze() go into small per-person overlay lists and update the index
+// incrementally; people first named after freeze() live in a deque (so views
+// into it never move) with their own hash map.
+//
+// The frozen arrays are Columns, which either own their storage or point into
+// a mapped snapshot file, so a saved KB is queried in place without parsing.
+//
+// Reachability index: every person gets a number, and reach[p] holds the
+// numbers of p and all of p's descendants as sorted, disjoint intervals.
+// People are numbered by generation, then by preorder of a spanning forest,
+// so each generation of a family line is one interval and once a line has
+// mixed into the whole population, all later generations collapse into one.
+// is_ancestor is then a binary search. Heavily interbred populations can still
+// fragment a descendant set, so each person keeps at most MAX_INTERVALS: past
+// that the closest intervals are merged and marked inexact (they may include
+// non-descendants), and a hit in an inexact interval is settled by a search
+// that only enters children whose own intervals contain the target.
+struct FamilyGraph {
+    struct Interval { int lo, hi; bool exact; };
+    using Intervals = vector<Interval>;
+    struct Span {
+        const Interval *b, *e;
+        const Interval *begin() const { return b; }
+        const Interval *end() const { return e; }
+    };
+    static const size_t MAX_INTERVALS = 16;
+    deque<string> names;                         // people not in strtab (everyone until freeze())
+    unordered_map<string, int> ids;              // used while loading
+    unordered_map<string_view, int> index;       // views into names, after freeze()
+    vector<pair<int,int>> edges;                 // (parent, child) while loading
+    Column<char> strtab;                         // frozen names, back to back
+    Column<uint64_t> name_off;                   // name i is strtab[name_off[i]..name_off[i+1])
+    Column<int> slots;                           // open-addressing name hash, -1 = empty
+    Column<int> child_off, child;                // children of p: child[child_off[p]..child_off[p+1])
+    Column<int> parent_off, parent;
+    bool frozen = false;
+    int frozen_n = 0;                            // people covered by the CSR arrays
+    size_t late_facts = 0;                       // facts given after freeze()
+    vector<vector<int>> added_children, added_parents;
+    Column<int> num;                             // index number per frozen person; later ones use their ID
+    Column<int> reach_off;                       // frozen intervals of p: reach_iv[reach_off[p]..reach_off[p+1])
+    Column<Interval> reach_iv;
+    vector<Intervals> reach_new;                 // replaces the frozen intervals once non-empty
+    mutable vector<int> stamp, stack;            // scratch for inexact is_ancestor hits
+    mutable int cur_stamp = 0;
+    // LCA index: binary lifting over the spanning forest (tree_up[j][v] is v's
+    // 2^j-th first-parent ancestor, -1 above a root) plus family components
+    vector<vector<int>> tree_up;
+    vector<int> tree_depth, comp;
+    mutable vector<int> mark_a, mark_b, dist_a, dist_b, front_a, front_b, next_front;
+    mutable int cur_mark = 0;
+    void *map = MAP_FAILED; size_t map_len = 0;
+
+    FamilyGraph() = default;
+    FamilyGraph(const FamilyGraph&) = delete;
+    FamilyGraph& operator=(const FamilyGraph&) = delete;
+    ~FamilyGraph(){ if(map!=MAP_FAILED) munmap(map, map_len); }
+
+    int size() const { return frozen_n+(int)names.size(); }
+    string_view name(int i) const {
+        if(i<frozen_n) return string_view(strtab.p+name_off[i], name_off[i+1]-name_off[i]);
+        return names[i-frozen_n];
+    }
+    static uint64_t hash_name(string_view s){ // FNV-1a: stable across runs, unlike std::hash
+        uint64_t h=1469598103934665603ull;
+        for(unsigned char c: s){ h^=c; h*=1099511628211ull; }
+        return h;
+    }
+    int num_of(int v) const { return v<frozen_n ? num[v] : v; }
+    Span reach_of(int v) const {
+        const Intervals &o=reach_new[v];
+        if(!o.empty()) return {o.data(), o.data()+o.size()};
+        return {reach_iv.p+reach_off[v], reach_iv.p+reach_off[v+1]};
+    }
+    static Span span(const Intervals &iv){ return {iv.data(), iv.data()+iv.size()}; }
+
+    int intern(const string &name){
+        if(!frozen){
+            auto it=ids.find(name);
+            if(it!=ids.end()) return it->second;
+            names.push_back(name);
+            return ids[name]=(int)names.size()-1;
+        }
+        int id=find(name);
+        if(id>=0) return id;
+        // a new person after freeze(): a fresh number (their ID) that only they cover
+        names.push_back(name);
+        id=size()-1;
+        index.emplace(string_view(names.back()), id);
+        added_children.emplace_back(); added_parents.emplace_back();
+        reach_new.push_back({{id, id, true}});
+        stamp.push_back(0);
+        for(auto &level: tree_up) level.push_back(-1);
+        tree_depth.push_back(0); comp.push_back(id);
+        for(auto *v: {&mark_a, &mark_b, &dist_a, &dist_b}) v->push_back(0);
+        return id;
+    }
+    void add_parent(const string &a, const string &b){
+        int pa=intern(a), cb=intern(b);
+        if(!frozen){ edges.push_back({pa, cb}); return; }
+        if(is_parent(pa, cb)) return;
+        late_facts++;
+        added_children[pa].push_back(cb);
+        added_parents[cb].push_back(pa);
+        comp[find_comp(pa)]=find_comp(cb);
+        // a person who had no parent yet hangs under this one in the forest;
+        // only if they have no descendants, since those would need new depths
+        if(tree_up[0][cb]<0 && !has_children(cb)) attach_tree(cb, pa);
+        // pa and every ancestor of pa now also reach all of reach[cb]; stop
+        // climbing wherever it is already covered, since ancestors cover more
+        Span s=reach_of(cb);
+        const Intervals add(s.begin(), s.end());
+        vector<int> work={pa};
+        if(++cur_stamp==0){ fill(stamp.begin(), stamp.end(), 0); cur_stamp=1; }
+        stamp[pa]=cur_stamp;
+        while(!work.empty()){
+            int x=work.back(); work.pop_back();
+            Span cur=reach_of(x);
+            if(covers(cur, span(add))) continue;
+            Intervals merged(cur.begin(), cur.end());
+            merged.insert(merged.end(), add.begin(), add.end());
+            normalize(merged);
+            reach_new[x].swap(merged);
+            auto visit=[&](int p){ if(stamp[p]!=cur_stamp){ stamp[p]=cur_stamp; work.push_back(p); } };
+            if(x<frozen_n) for(int i=parent_off[x];i<parent_off[x+1];i++) visit(parent[i]);
+            for(int p: added_parents[x]) visit(p);
+        }
+    }
+    static void build_csr(int n, const vector<pair<int,int>> &e, bool by_first, Column<int> &off_col, Column<int> &adj_col){
+        vector<int> off(n+1, 0), adj;
+        for(auto &p: e) off[(by_first ? p.first : p.second)+1]++;
+        for(int i=0;i<n;i++) off[i+1]+=off[i];
+        adj.resize(e.size());
+        vector<int> pos(off.begin(), off.end()-1);
+        for(auto &p: e) adj[pos[by_first ? p.first : p.second]++] = by_first ? p.second : p.first;
+        for(int i=0;i<n;i++){
+            sort(adj.begin()+off[i], adj.begin()+off[i+1]);
+        }
+        // drop duplicate facts, compacting the rows
+        int k=0;
+        for(int i=0;i<n;i++){
+            int lo=off[i], hi=off[i+1];
+            off[i]=k;
+            for(int j=lo;j<hi;j++) if(j==lo || adj[j]!=adj[j-1]) adj[k++]=adj[j];
+        }
+        off[n]=k;
+        adj.resize(k);
+        off_col.adopt(move(off)); adj_col.adopt(move(adj));
+    }
+    // Sorts and merges overlapping intervals (and adjacent ones of the same
+    // kind); a merge is exact only if every point was covered exactly. Then
+    // enforces MAX_INTERVALS by closing the smallest gaps into inexact intervals.
+    static void normalize(Intervals &iv){
+        sort(iv.begin(), iv.end(), [](const Interval &a, const Interval &b){ return a.lo!=b.lo ? a.lo<b.lo : a.hi>b.hi; });
+        size_t k=0;
+        for(size_t i=0;i<iv.size();i++){
+            Interval &cur=iv[i];
+            if(k>0){
+                Interval &top=iv[k-1];
+                if(cur.hi<=top.hi){ continue; } // contained: top's exactness stands (an exact cur inside an inexact top adds nothing)
+                if(cur.lo<=top.hi || (cur.lo==top.hi+1 && cur.exact==top.exact)){
+                    top.hi=cur.hi; top.exact=top.exact && cur.exact;
+                    continue;
+                }
+            }
+            iv[k++]=cur;
+        }
+        iv.resize(k);
+        if(iv.size()<=MAX_INTERVALS) return;
+        // keep the MAX_INTERVALS-1 widest gaps as separators, close the rest
+        vector<int> gaps(iv.size()-1);
+        for(size_t i=0;i+1<iv.size();i++) gaps[i]=iv[i+1].lo-iv[i].hi;
+        vector<int> sorted_gaps=gaps;
+        nth_element(sorted_gaps.begin(), sorted_gaps.end()-(MAX_INTERVALS-1), sorted_gaps.end());
+        int cut=*(sorted_gaps.end()-(MAX_INTERVALS-1));
+        size_t keep_equal=0; // gaps equal to cut that may still be kept
+        for(size_t i=sorted_gaps.size()-(MAX_INTERVALS-1);i<sorted_gaps.size();i++) keep_equal+=sorted_gaps[i]==cut;
+        k=0;
+        for(size_t i=0;i<iv.size();i++){
+            bool separate = i==0 || gaps[i-1]>cut || (gaps[i-1]==cut && keep_equal>0 && keep_equal--);
+            if(separate) iv[k++]=iv[i];
+            else { iv[k-1].hi=iv[i].hi; iv[k-1].exact=false; }
+        }
+        iv.resize(k);
+    }
+    // 0: x not covered, 1: inside an exact interval, 2: inside an inexact one
+    static int lookup(Span iv, int x){
+        auto it=upper_bound(iv.begin(), iv.end(), x, [](int v, const Interval &i){ return v<i.lo; });
+        if(it==iv.begin() || prev(it)->hi<x) return 0;
+        return prev(it)->exact ? 1 : 2;
+    }
+    static bool covers(Span iv, Span sub){
+        for(auto &s: sub){
+            auto it=upper_bound(iv.begin(), iv.end(), s.lo, [](int v, const Interval &i){ return v<i.lo; });
+            if(it==iv.begin() || prev(it)->hi<s.hi || (s.exact && !prev(it)->exact)) return false;
+        }
+        return true;
+    }
+    void build_index(){
+        int n=frozen_n;
+        // generations (longest path from a root), parents before children
+        vector<int> gen(n, 0), pending(n), topo;
+        topo.reserve(n);
+        for(int v=0;v<n;v++){ pending[v]=parent_off[v+1]-parent_off[v]; if(!pending[v]) topo.push_back(v); }
+        for(size_t i=0;i<topo.size();i++){
+            int v=topo[i];
+            for(int k=child_off[v];k<child_off[v+1];k++){
+                int c=child[k];
+                gen[c]=max(gen[c], gen[v]+1);
+                if(--pending[c]==0) topo.push_back(c);
+            }
+        }
+        // preorder of the spanning forest: each person hangs under their first parent
+        vector<int> pre(n, INT32_MAX), stack;
+        int counter=0;
+        for(int r=0;r<n;r++){
+            if(parent_off[r]<parent_off[r+1]) continue;
+            stack.push_back(r);
+            while(!stack.empty()){
+                int v=stack.back(); stack.pop_back();
+                pre[v]=counter++;
+                for(int k=child_off[v+1]-1;k>=child_off[v];k--){
+                    int c=child[k];
+                    if(parent[parent_off[c]]==v) stack.push_back(c);
+                }
+            }
+        }
+        // number by (generation, preorder): a subtree's members in one generation
+        // are contiguous, and whole later generations form a single interval
+        vector<int> by_num(n), number(n);
+        for(int v=0;v<n;v++) by_num[v]=v;
+        sort(by_num.begin(), by_num.end(), [&](int a,int b){ return gen[a]!=gen[b] ? gen[a]<gen[b] : pre[a]<pre[b]; });
+        for(int i=0;i<n;i++) number[by_num[i]]=i;
+        // children before parents (people on an ancestry cycle are never
+        // reached and only cover themselves)
+        vector<Intervals> reach(n);
+        for(int v=0;v<n;v++) reach[v]={{number[v],number[v],true}};
+        for(int i=(int)topo.size()-1;i>=0;i--){
+            int v=topo[i];
+            Intervals &iv=reach[v];
+            for(int k=child_off[v];k<child_off[v+1];k++) iv.insert(iv.end(), reach[child[k]].begin(), reach[child[k]].end());
+            normalize(iv);
+        }
+        vector<int> off(n+1, 0);
+        for(int v=0;v<n;v++) off[v+1]=off[v]+reach[v].size();
+        vector<Interval> flat;
+        flat.reserve(off[n]);
+        for(auto &iv: reach){ flat.insert(flat.end(), iv.begin(), iv.end()); Intervals().swap(iv); }
+        num.adopt(move(number)); reach_off.adopt(move(off)); reach_iv.adopt(move(flat));
+    }
+    void build_slots(){
+        size_t cap=2;
+        while(cap<2*size_t(frozen_n)) cap*=2;
+        vector<int> s(cap, -1);
+        for(int i=0;i<frozen_n;i++){
+            size_t h=hash_name(name(i))&(cap-1);
+            while(s[h]>=0) h=(h+1)&(cap-1);
+            s[h]=i;
+        }
+        slots.adopt(move(s));
+    }
+    // per-person overlays and query scratch, sized for the frozen people
+    void init_scratch(){
+        int n=frozen_n;
+        added_children.assign(n, {}); added_parents.assign(n, {});
+        reach_new.assign(n, {});
+        stamp.assign(n, 0); stack.reserve(n);
+        for(auto *v: {&mark_a, &mark_b, &dist_a, &dist_b}) v->assign(n, 0);
+    }
+    // Packs the interned names (tab/off) and the loaded edges into the frozen
+    // arrays and builds every index.
+    void freeze_from(vector<char> &&tab, vector<uint64_t> &&off){
+        int n=off.size()-1;
+        strtab.adopt(move(tab)); name_off.adopt(move(off));
+        build_csr(n, edges, true, child_off, child);
+        build_csr(n, edges, false, parent_off, parent);
+        vector<pair<int,int>>().swap(edges);
+        frozen=true; frozen_n=n;
+        build_slots();
+        build_index();
+        build_lca();
+        init_scratch();
+    }
+    void freeze(){
+        vector<char> tab;
+        vector<uint64_t> off={0};
+        for(auto &s: names){ tab.insert(tab.end(), s.begin(), s.end()); off.push_back(tab.size()); }
+        names.clear(); ids.clear();
+        freeze_from(move(tab), move(off));
+    }
+    int find(string_view s) const {
+        if(slots.size()){
+            size_t mask=slots.size()-1;
+            for(size_t h=hash_name(s)&mask; slots[h]>=0; h=(h+1)&mask)
+                if(name(slots[h])==s) return slots[h];
+        }
+        auto it=index.find(s);
+        return it==index.end() ? -1 : it->second;
+    }
+
+    bool is_parent(int a,int b) const {
+        if(a<frozen_n && binary_search(child.begin()+child_off[a], child.begin()+child_off[a+1], b)) return true;
+        for(int c: added_children[a]) if(c==b) return true;
+        return false;
+    }
+    int parent_count(int v) const {
+        return (v<frozen_n ? parent_off[v+1]-parent_off[v] : 0) + (int)added_parents[v].size();
+    }
+    // From the lifting table: b's grandparent in the spanning forest is two
+    // steps up, at depth[b]-2. When b and its parent each have one parent
+    // that is the only grandparent; otherwise each parent of b is checked.
+    bool is_grandparent(int a,int b) const {
+        if(comp_root(a)!=comp_root(b)) return false;
+        int p=tree_up[0][b], g = p<0 ? -1 : tree_up[0][p];
+        if(g==a && tree_depth[b]-tree_depth[a]==2) return true;
+        if(g>=0 && parent_count(b)==1 && parent_count(p)==1) return false;
+        bool found=false;
+        for_each_parent(b, [&](int p){ if(!found && is_parent(a,p)) found=true; });
+        return found;
+    }
+    bool is_sibling(int a,int b) const {
+        if(a==b) return false;
+        if(a<frozen_n && b<frozen_n){
+            int i=parent_off[a], ie=parent_off[a+1], j=parent_off[b], je=parent_off[b+1];
+            while(i<ie && j<je){
+                if(parent[i]==parent[j]) return true;
+                if(parent[i]<parent[j]) i++; else j++;
+            }
+        }
+        for(int p: added_parents[a]) if(is_parent(p,b)) return true;
+        for(int p: added_parents[b]) if(is_parent(p,a)) return true;
+        return false;
+    }
+    bool is_ancestor(int a,int b) const {
+        if(a==b) return false;
+        int x=num_of(b), hit=lookup(reach_of(a), x);
+        if(hit!=2) return hit==1;
+        if(++cur_stamp==0){ fill(stamp.begin(), stamp.end(), 0); cur_stamp=1; }
+        stack.clear(); stack.push_back(a);
+        while(!stack.empty()){
+            int p=stack.back(); stack.pop_back();
+            auto visit=[&](int c){
+                if(stamp[c]==cur_stamp) return false;
+                stamp[c]=cur_stamp;
+                int h = c==b ? 1 : lookup(reach_of(c), x);
+                if(h==2) stack.push_back(c);
+                return h==1;
+            };
+            if(p<frozen_n) for(int i=child_off[p];i<child_off[p+1];i++) if(visit(child[i])) return true;
+            for(int c: added_children[p]) if(visit(c)) return true;
+        }
+        return false;
+    }
+
+    int find_comp(int v){
+        while(comp[v]!=v){ comp[v]=comp[comp[v]]; v=comp[v]; }
+        return v;
+    }
+    int comp_root(int v) const {
+        while(comp[v]!=v) v=comp[v];
+        return v;
+    }
+    bool has_children(int v) const {
+        return (v<frozen_n && child_off[v]<child_off[v+1]) || !added_children[v].empty();
+    }
+    template<class F> void for_each_parent(int v, F f) const {
+        if(v<frozen_n) for(int i=parent_off[v];i<parent_off[v+1];i++) f(parent[i]);
+        for(int p: added_parents[v]) f(p);
+    }
+    void attach_tree(int v, int p){
+        tree_depth[v]=tree_depth[p]+1;
+        if((1<<tree_up.size())<=tree_depth[v]){ // one more lifting level
+            tree_up.emplace_back(size(), -1);
+            size_t j=tree_up.size()-1;
+            for(int u=0;u<size();u++){ int m=tree_up[j-1][u]; tree_up[j][u] = m<0 ? -1 : tree_up[j-1][m]; }
+        }
+        tree_up[0][v]=p;
+        for(size_t j=1;j<tree_up.size();j++){ int m=tree_up[j-1][v]; tree_up[j][v] = m<0 ? -1 : tree_up[j-1][m]; }
+    }
+    void build_lca(){
+        int n=frozen_n;
+        comp.resize(n);
+        for(int v=0;v<n;v++) comp[v]=v;
+        for(int v=0;v<n;v++) for(int i=child_off[v];i<child_off[v+1];i++) comp[find_comp(v)]=find_comp(child[i]);
+        // forest depths in parent-before-child order (preorder of each tree)
+        tree_depth.assign(n, 0);
+        vector<int> order, stack;
+        for(int r=0;r<n;r++){
+            if(parent_off[r]<parent_off[r+1]) continue;
+            stack.push_back(r);
+            while(!stack.empty()){
+                int v=stack.back(); stack.pop_back();
+                order.push_back(v);
+                for(int k=child_off[v];k<child_off[v+1];k++)
+                    if(parent[parent_off[child[k]]]==v){ tree_depth[child[k]]=tree_depth[v]+1; stack.push_back(child[k]); }
+            }
+        }
+        int max_depth=0;
+        for(int v: order) max_depth=max(max_depth, tree_depth[v]);
+        int levels=1;
+        while((1<<levels)<=max_depth) levels++;
+        tree_up.assign(levels, vector<int>(n, -1));
+        for(int v=0;v<n;v++) if(parent_off[v]<parent_off[v+1]) tree_up[0][v]=parent[parent_off[v]];
+        for(int j=1;j<levels;j++) for(int v: order){ int m=tree_up[j-1][v]; tree_up[j][v] = m<0 ? -1 : tree_up[j-1][m]; }
+    }
+    int tree_lca(int a,int b) const {
+        if(tree_depth[a]<tree_depth[b]) swap(a,b);
+        for(int j=tree_up.size()-1;j>=0;j--)
+            if(tree_depth[a]-(1<<j)>=tree_depth[b]) a=tree_up[j][a];
+        if(a==b) return a;
+        for(int j=tree_up.size()-1;j>=0;j--)
+            if(tree_up[j][a]!=tree_up[j][b]){ a=tree_up[j][a]; b=tree_up[j][b]; }
+        return tree_up[0][a]==tree_up[0][b] ? tree_up[0][a] : -1; // -1: different trees
+    }
+
+    // Nearest common ancestor: the shared ancestor c minimising
+    // dist(c,a)+dist(c,b) (generations up each side; ties prefer equal sides).
+    // People in different families are rejected by component id, and the
+    // spanning-forest LCA from the lifting table (O(log n)) gives an upper
+    // bound; the exact answer comes from a level-by-level climb from both
+    // people cut off at that bound. With two parents each, a climb of k
+    // generations meets up to 2^k ancestors, so the cost depends on how
+    // distant the relation is rather than on the size of the graph.
+    struct Nca { int anc=-1, da=-1, db=-1; };
+    Nca nearest_common_ancestor(int a,int b) const {
+        Nca best;
+        if(comp_root(a)!=comp_root(b)) return best;
+        auto better=[&](int c, int da, int db){
+            if(best.anc<0 || da+db<best.da+best.db || (da+db==best.da+best.db && abs(da-db)<abs(best.da-best.db)))
+                best={c, da, db};
+        };
+        int t=tree_lca(a,b);
+        if(t>=0) better(t, tree_depth[a]-tree_depth[t], tree_depth[b]-tree_depth[t]);
+        if(++cur_mark==0){ fill(mark_a.begin(),mark_a.end(),0); fill(mark_b.begin(),mark_b.end(),0); cur_mark=1; }
+        front_a.assign(1,a); front_b.assign(1,b);
+        mark_a[a]=cur_mark; dist_a[a]=0; mark_b[b]=cur_mark; dist_b[b]=0;
+        if(a==b) better(a,0,0);
+        // a candidate first met at level L of one climb is L generations up
+        // that side, so a climb is only worth extending while L <= best sum
+        int la=0, lb=0;
+        auto open=[&](const vector<int> &front, int level){ return !front.empty() && (best.anc<0 || level+1<=best.da+best.db); };
+        while(open(front_a, la) || open(front_b, lb)){
+            bool side_a = !open(front_b, lb) || (open(front_a, la) && front_a.size()<=front_b.size());
+            vector<int> &front = side_a ? front_a : front_b;
+            vector<int> &mark = side_a ? mark_a : mark_b, &dist = side_a ? dist_a : dist_b;
+            const vector<int> &other_mark = side_a ? mark_b : mark_a, &other_dist = side_a ? dist_b : dist_a;
+            int level = (side_a ? ++la : ++lb);
+            next_front.clear();
+            for(int v: front) for_each_parent(v, [&](int p){
+                if(mark[p]==cur_mark) return;
+                mark[p]=cur_mark; dist[p]=level;
+                next_front.push_back(p);
+                if(other_mark[p]==cur_mark) side_a ? better(p, level, other_dist[p]) : better(p, other_dist[p], level);
+            });
+            front.swap(next_front);
+        }
+        return best;
+    }
+    bool is_cousin(int a,int b,int k) const {
+        Nca n=nearest_common_ancestor(a,b);
+        return n.anc>=0 && n.da==k+1 && n.db==k+1;
+    }
+
+    // Bulk load: the fact file is mapped and cut into one chunk per thread at
+    // line boundaries. Each thread tokenizes its chunk in place and interns
+    // names into a local table; the local tables are then merged in chunk
+    // order (so IDs follow first appearance, as with interactive loading) and
+    // each thread rewrites its own edges to global IDs. Lines other than
+    // "parent A B" are counted and skipped.
+    bool bulk_load(const string &file, int threads){
+        int fd=open(file.c_str(), O_RDONLY);
+        if(fd<0){ cerr<<"Cannot open "<<file<<"\n"; return false; }
+        struct stat st;
+        if(fstat(fd,&st)!=0){ close(fd); cerr<<"Cannot stat "<<file<<"\n"; return false; }
+        size_t len=st.st_size;
+        const char *text="";
+        void *m=MAP_FAILED;
+        if(len>0){
+            m=mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(m==MAP_FAILED){ close(fd); cerr<<"mmap failed for "<<file<<"\n"; return false; }
+            madvise(m, len, MADV_SEQUENTIAL);
+            text=(const char*)m;
+        }
+        close(fd);
+        threads=max(1, threads);
+        vector<size_t> cut(threads+1, len);
+        cut[0]=0;
+        for(int t=1;t<threads;t++){
+            size_t c=max(cut[t-1], len/threads*t);
+            while(c>0 && c<len && text[c-1]!='\n') c++;
+            cut[t]=c;
+        }
+        // open-addressing name table; IDs are dense in insertion order
+        struct Interner {
+            vector<int> slot=vector<int>(1024, -1);
+            vector<string_view> keys;
+            vector<uint64_t> hashes;
+            int insert(string_view s, uint64_t h){
+                if(2*keys.size()>=slot.size()) grow();
+                size_t mask=slot.size()-1, i=h&mask;
+                for(; slot[i]>=0; i=(i+1)&mask)
+                    if(hashes[slot[i]]==h && keys[slot[i]]==s) return slot[i];
+                slot[i]=keys.size(); keys.push_back(s); hashes.push_back(h);
+                return slot[i];
+            }
+            void grow(){
+                slot.assign(slot.size()*2, -1);
+                size_t mask=slot.size()-1;
+                for(size_t k=0;k<keys.size();k++){
+                    size_t i=hashes[k]&mask;
+                    while(slot[i]>=0) i=(i+1)&mask;
+                    slot[i]=k;
+                }
+            }
+        };
+        struct Chunk {
+            Interner local;
+            vector<pair<int,int>> edges;
+            vector<int> global;                  // local ID -> global ID
+            size_t bad=0;
+        };
+        vector<Chunk> chunks(threads);
+        auto parse=[&](int t){
+            Chunk &ch=chunks[t];
+            auto id_of=[&](string_view s){ return ch.local.insert(s, hash_name(s)); };
+            const char *p=text+cut[t], *end=text+cut[t+1];
+            while(p<end){
+                const char *eol=(const char*)memchr(p, '\n', end-p);
+                if(!eol) eol=end;
+                string_view tok[4];
+                int n=0;
+                for(const char *q=p; n<4;){
+                    while(q<eol && isspace((unsigned char)*q)) q++;
+                    if(q==eol) break;
+                    const char *s=q;
+                    while(q<eol && !isspace((unsigned char)*q)) q++;
+                    tok[n++]=string_view(s, q-s);
+                }
+                if(n==3 && tok[0]=="parent") ch.edges.push_back({id_of(tok[1]), id_of(tok[2])});
+                else if(n>0) ch.bad++;
+                p=eol+1;
+            }
+        };
+        auto run=[&](auto f){
+            vector<thread> pool;
+            for(int t=0;t<threads;t++) pool.emplace_back(f, t);
+            for(auto &th: pool) th.join();
+        };
+        run(parse);
+        // merge the local name tables into the string table
+        Interner global;
+        size_t total=0, bad=0;
+        for(auto &ch: chunks){ total+=ch.edges.size(); bad+=ch.bad; }
+        vector<char> tab;
+        vector<uint64_t> off={0};
+        for(auto &ch: chunks){
+            Interner &l=ch.local;
+            ch.global.resize(l.keys.size());
+            for(size_t i=0;i<l.keys.size();i++){
+                int id=global.insert(l.keys[i], l.hashes[i]);
+                if(id==(int)off.size()-1){ tab.insert(tab.end(), l.keys[i].begin(), l.keys[i].end()); off.push_back(tab.size()); }
+                ch.global[i]=id;
+            }
+            ch.local=Interner();
+        }
+        global=Interner();
+        edges.resize(total);
+        vector<size_t> base(threads+1, 0);
+        for(int t=0;t<threads;t++) base[t+1]=base[t]+chunks[t].edges.size();
+        run([&](int t){
+            Chunk &ch=chunks[t];
+            for(size_t i=0;i<ch.edges.size();i++) edges[base[t]+i]={ch.global[ch.edges[i].first], ch.global[ch.edges[i].second]};
+            vector<pair<int,int>>().swap(ch.edges);
+        });
+        chunks.clear();
+        if(m!=MAP_FAILED) munmap(m, len); // names now live in tab
+        if(bad) cerr<<bad<<" malformed lines skipped\n";
+        freeze_from(move(tab), move(off));
+        return true;
+    }
+
+    // Snapshot file: Header, then the frozen arrays back to back in the order
+    // below (name_off first for 8-byte alignment, strtab last). open_snapshot()
+    // uses the name table, hash, CSR arrays and intervals in place; only the
+    // LCA arrays, which later facts may change, are copied.
+    struct Header {
+        char magic[8]; // "FAMKB1"
+        uint64_t people, strtab_bytes, slots, children, parents, intervals, lca_levels;
+    };
+    bool save(const string &file) const {
+        if(!frozen || !names.empty() || late_facts){ cerr<<"Only a freshly frozen KB can be saved\n"; return false; }
+        FILE *f=fopen(file.c_str(), "wb");
+        if(!f){ cerr<<"Cannot write "<<file<<"\n"; return false; }
+        Header h={};
+        strcpy(h.magic, "FAMKB1");
+        h.people=frozen_n; h.strtab_bytes=strtab.size(); h.slots=slots.size();
+        h.children=child.size(); h.parents=parent.size(); h.intervals=reach_iv.size(); h.lca_levels=tree_up.size();
+        vector<int> roots(frozen_n);
+        for(int v=0;v<frozen_n;v++) roots[v]=comp_root(v);
+        auto put=[&](const void *p, size_t bytes){ if(bytes) fwrite(p, 1, bytes, f); };
+        auto put_col=[&](const auto &c){ put(c.begin(), c.size()*sizeof(c[0])); };
+        put(&h, sizeof h);
+        put_col(name_off); put_col(slots);
+        put_col(child_off); put_col(child); put_col(parent_off); put_col(parent);
+        put_col(num); put_col(reach_off);
+        // Intervals go through a zeroed buffer field by field so the padding
+        // after 'exact' is written as zeros rather than leftover heap bytes.
+        vector<char> buf(4096*sizeof(Interval));
+        for(size_t i=0;i<reach_iv.size();){
+            size_t n=min(reach_iv.size()-i, size_t(4096));
+            fill(buf.begin(), buf.end(), 0);
+            for(size_t k=0;k<n;k++){
+                char *d=buf.data()+k*sizeof(Interval);
+                const Interval &iv=reach_iv[i+k];
+                memcpy(d+offsetof(Interval,lo), &iv.lo, sizeof iv.lo);
+                memcpy(d+offsetof(Interval,hi), &iv.hi, sizeof iv.hi);
+                memcpy(d+offsetof(Interval,exact), &iv.exact, sizeof iv.exact);
+            }
+            put(buf.data(), n*sizeof(Interval));
+            i+=n;
+        }
+        put(tree_depth.data(), frozen_n*sizeof(int)); put(roots.data(), frozen_n*sizeof(int));
+        for(auto &level: tree_up) put(level.data(), frozen_n*sizeof(int));
+        put_col(strtab);
+        return fclose(f)==0;
+    }
+    bool open_snapshot(const string &file){
+        int fd=open(file.c_str(), O_RDONLY);
+        if(fd<0){ cerr<<"Cannot open "<<file<<"\n"; return false; }
+        struct stat st;
+        if(fstat(fd,&st)!=0 || size_t(st.st_size)<sizeof(Header)){ close(fd); cerr<<"Bad snapshot file\n"; return false; }
+        map_len=st.st_size;
+        map=mmap(nullptr, map_len, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if(map==MAP_FAILED){ cerr<<"mmap failed for "<<file<<"\n"; return false; }
+        const Header *h=(const Header*)map;
+        if(strcmp(h->magic, "FAMKB1")!=0){ cerr<<file<<" is not a family KB snapshot\n"; return false; }
+        size_t n=h->people, ints=(n+1)*3+n*(3+h->lca_levels)+h->slots+h->children+h->parents;
+        size_t need=sizeof(Header)+(n+1)*sizeof(uint64_t)+ints*sizeof(int)+h->intervals*sizeof(Interval)+h->strtab_bytes;
+        if(need!=map_len){ cerr<<"Snapshot "<<file<<" is truncated\n"; return false; }
+        const char *p=(const char*)map+sizeof(Header);
+        auto take=[&](auto &col, size_t count){
+            using T=typename remove_reference<decltype(col[0])>::type;
+            col.view((const T*)p, count); p+=count*sizeof(T);
+        };
+        auto copy=[&](vector<int> &v){ v.assign((const int*)p, (const int*)p+n); p+=n*sizeof(int); };
+        take(name_off, n+1); take(slots, h->slots);
+        take(child_off, n+1); take(child, h->children); take(parent_off, n+1); take(parent, h->parents);
+        take(num, n); take(reach_off, n+1); take(reach_iv, h->intervals);
+        copy(tree_depth); copy(comp);
+        tree_up.resize(h->lca_levels);
+        for(auto &level: tree_up) copy(level);
+        take(strtab, h->strtab_bytes);
+        frozen=true; frozen_n=n;
+        init_scratch();
+        return true;
+    }
+};
+
+// Splits line on whitespace into views; returns the number of tokens (at most max).
+int split_tokens(const string &line, string_view *out, int max){
+    int n=0; size_t i=0;
+    while(n<max){
+        while(i<line.size() && isspace((unsigned char)line[i])) i++;
+        if(i==line.size()) break;
+        size_t j=i;
+        while(j<line.size() && !isspace((unsigned char)line[j])) j++;
+        out[n++]=string_view(line).substr(i, j-i);
+        i=j;
+    }
+    return n;
 }
 
-int main(){
+int main(int argc, char **argv){
     ios::sync_with_stdio(false);
     cin.tie(nullptr);
-    cout<<"Enter facts (one per line), e.g. 'parent alice bob'. Type 'queries' to switch:\n";
+    FamilyGraph g;
+    string mode = argc>1 ? argv[1] : "";
     string line;
-    while(getline(cin,line)){
-        if(line.empty()) continue;
-        if(line=="queries") break;
-        if(line=="exit") return 0;
-        istringstream iss(line);
-        string pred,a,b; iss>>pred>>a>>b;
-        if(pred=="parent"){
-            children_of[a].push_back(b);
-            parents_of[b].push_back(a);
-        } else {
-            cout<<"Unknown fact format. Use 'parent A B'\n";
+    string_view tok[4];
+    if(mode=="load" && argc>=3){
+        string snapshot;
+        int threads=thread::hardware_concurrency();
+        for(int i=3;i<argc;i++){
+            string arg=argv[i];
+            if(arg=="--threads" && i+1<argc) threads=atoi(argv[++i]);
+            else snapshot=arg;
+        }
+        auto t0=chrono::steady_clock::now();
+        if(!g.bulk_load(argv[2], threads)) return 1;
+        auto t1=chrono::steady_clock::now();
+        cerr<<"loaded "<<g.size()<<" people, "<<g.child.size()<<" facts in "
+            <<chrono::duration<double>(t1-t0).count()<<" s\n";
+        if(!snapshot.empty() && !g.save(snapshot)) return 1;
+    } else if(mode=="open" && argc==3){
+        auto t0=chrono::steady_clock::now();
+        if(!g.open_snapshot(argv[2])) return 1;
+        cerr<<"opened "<<g.size()<<" people in "<<chrono::duration<double>(chrono::steady_clock::now()-t0).count()<<" s\n";
+    } else if(argc>1){
+        cout<<"Usage: "<<argv[0]<<" | load <facts> [snapshot] [--threads T] | open <snapshot>\n"; return 1;
+    } else {
+        cout<<"Enter facts (one per line), e.g. 'parent alice bob'. Type 'queries' to switch:\n";
+        while(getline(cin,line)){
+            if(line.empty()) continue;
+            if(line=="queries") break;
+            if(line=="exit") return 0;
+            int n=split_tokens(line, tok, 3);
+            if(n==3 && tok[0]=="parent"){
+                g.add_parent(string(tok[1]), string(tok[2]));
+            } else {
+                cout<<"Unknown fact format. Use 'parent A B'\n";
+            }
         }
+        g.freeze();
     }
-    cout<<"Now enter queries. Examples: is_parent A B, is_grandparent A C, is_sibling A B, is_ancestor A D. Type 'exit' to stop.\n";
+    cout<<"Now enter queries. Examples: is_parent A B, is_grandparent A C, is_sibling A B, is_ancestor A D,\n"
+          "is_cousin A B K, common_ancestor A B, generation_gap A B. Type 'exit' to stop.\n";
     while(getline(cin,line)){
         if(line.empty()) continue;
         if(line=="exit") break;
-        istringstream iss(line);
-        string q,a,b; iss>>q>>a>>b;
+        int n=split_tokens(line, tok, 4);
+        string_view q = n>0 ? tok[0] : string_view();
+        if(q=="parent" && n==3){ g.add_parent(string(tok[1]), string(tok[2])); continue; }
+        int a = n>1 ? g.find(tok[1]) : -1, b = n>2 ? g.find(tok[2]) : -1;
+        bool known = a>=0 && b>=0; // unknown people are in no relation
         if(q=="is_parent"){
-            cout<<(is_parent(a,b)?"YES":"NO")<<"\n";
+            cout<<(known && g.is_parent(a,b)?"YES":"NO")<<"\n";
         } else if(q=="is_grandparent"){
-            cout<<(is_grandparent(a,b)?"YES":"NO")<<"\n";
+            cout<<(known && g.is_grandparent(a,b)?"YES":"NO")<<"\n";
         } else if(q=="is_sibling"){
-            cout<<(is_sibling(a,b)?"YES":"NO")<<"\n";
+            cout<<(known && g.is_sibling(a,b)?"YES":"NO")<<"\n";
         } else if(q=="is_ancestor"){
-            unordered_set<string> visited; cout<<(is_ancestor(a,b,visited)?"YES":"NO")<<"\n";
+            cout<<(known && g.is_ancestor(a,b)?"YES":"NO")<<"\n";
+        } else if(q=="is_cousin"){
+            int k = n>3 ? atoi(string(tok[3]).c_str()) : 1;
+            cout<<(known && k>=1 && g.is_cousin(a,b,k)?"YES":"NO")<<"\n";
+        } else if(q=="common_ancestor"){
+            auto r = known ? g.nearest_common_ancestor(a,b) : FamilyGraph::Nca();
+            if(r.anc>=0) cout<<g.name(r.anc)<<"\n"; else cout<<"NONE\n";
+        } else if(q=="generation_gap"){
+            auto r = known ? g.nearest_common_ancestor(a,b) : FamilyGraph::Nca();
+            if(r.anc>=0) cout<<r.db-r.da<<"\n"; else cout<<"NONE\n";
         } else {
             cout<<"Unknown query\n";
         }
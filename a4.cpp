@@ -1,107 +1,1224 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <vector>
 #include <queue>
-#include <unordered_map>
-#include <unordered_set>
+#include <string>
 #include <algorithm>
 #include <functional>
+#include <chrono>
+#include <iomanip>
+#include <climits>
+#include <atomic>
+#include <thread>
 
 using namespace std;
 
-struct PairHash {
-    size_t operator()(const pair<int,int>& p) const noexcept {
-        return hash<int>()(p.first) ^ (hash<int>()(p.second) << 1);
-    }
-};
+/*
+Grid path finding: A*, Jump Point Search and JPS+.
+  a4                                      demo on a built-in 5x5 grid
+  a4 <file.map> <file.scen> [algo] [--diag]   run every query of a MovingAI scenario
+  a4 <file.map> sr sc gr gc [algo] [--diag]   one query, prints the path
+  a4 selftest                             HPA* checks on one-cluster-wide maps
+algo is astar (binary heap), astar-bucket (bucket queue), alt (A* with
+landmark bounds), jps, jps+, hpa, dstar or all (scenarios only: runs each
+and checks that the exact ones agree); default astar. hpa takes --cluster N
+(default 16), alt takes --landmarks K (default 8). dstar walks each
+scenario's path, dropping an obstacle ahead every few steps, and compares
+D* Lite's repairs with replanning by A* from scratch. --threads T spreads
+the scenario queries of astar and alt over T threads (default 1).
+--diag allows 8-connected moves (diagonals may not cut corners) with the
+octile heuristic; otherwise moves are 4-connected with Manhattan distance.
+Maps use the MovingAI format ('.', 'G' and 'S' are passable, anything else is
+blocked), extended with digits '1'-'9' for passable terrain of that cost;
+entering a cell costs its terrain cost times the step length. JPS and JPS+
+need uniform costs. Scenario coordinates are x = column, y = row.
+*/
 
 using P = pair<int,int>;
 
+// Row-major grid in one buffer; cell (r, c) is cells[r * cols + c], the cost
+// of entering it, with 0 = blocked.
+struct Grid {
+    int rows = 0, cols = 0;
+    vector<int> cells;
+    int min_cost = 1, max_cost = 1; // over passable cells
+
+    Grid() = default;
+    // rows of 0 = free, 1 = blocked
+    Grid(const vector<vector<int>>& g) : rows(g.size()), cols(g.empty() ? 0 : g[0].size()) {
+        for (auto& row : g) for (int v : row) cells.push_back(v == 1 ? 0 : 1);
+    }
+    void update_costs() {
+        min_cost = INT_MAX; max_cost = 1;
+        for (int v : cells) if (v) { min_cost = min(min_cost, v); max_cost = max(max_cost, v); }
+        if (min_cost == INT_MAX) min_cost = 1;
+    }
+    bool uniform() const { return min_cost == max_cost; }
+    int size() const { return rows * cols; }
+    int index(P p) const { return p.first * cols + p.second; }
+    P pos(int i) const { return {i / cols, i % cols}; }
+    bool inside(int r, int c) const { return r >= 0 && c >= 0 && r < rows && c < cols; }
+    bool blocked(int i) const { return cells[i] == 0; }
+    bool passable(int r, int c) const { return inside(r, c) && !blocked(r * cols + c); }
+};
+
 struct PQItem {
     int f, g;
-    P pos;
+    int pos;
     bool operator>(const PQItem& other) const {
-        return f > other.f;
+        return f > other.f || (f == other.f && g < other.g); // ties: deeper first
     }
 };
 
-vector<P> reconstruct_path(unordered_map<P, P, PairHash>& cameFrom, P current) {
-    vector<P> total_path = {current};
-    while (cameFrom.find(current) != cameFrom.end()) {
-        current = cameFrom[current];
-        total_path.push_back(current);
+// Open list for integer f-values with a consistent heuristic: every push
+// lies in [f of the last pop, that + 2 * largest step], so a ring of buckets
+// that wide, indexed by f modulo its size, holds the whole list. Push is
+// O(1); pop scans forward from the last minimum to the next non-empty
+// bucket, amortised O(1) per f-level. Buckets are LIFO, so ties on f go
+// to the most recently pushed, usually deeper, cell.
+struct BucketQueue {
+    vector<vector<PQItem>> ring;
+    int min_f = 0;
+    size_t count = 0;
+
+    void reset(int max_step) {
+        size_t size = 2 * size_t(max_step) + 1;
+        if (ring.size() != size) ring.assign(size, {});
+        else if (count) for (auto& b : ring) b.clear();
+        count = 0; min_f = 0;
+    }
+    void push(PQItem item) {
+        if (!count || item.f < min_f) min_f = item.f;
+        ring[item.f % ring.size()].push_back(item);
+        count++;
     }
+    PQItem pop() {
+        vector<PQItem>* b;
+        while ((b = &ring[min_f % ring.size()])->empty()) min_f++;
+        PQItem t = b->back(); b->pop_back(); count--;
+        return t;
+    }
+};
+
+// Search state kept in dense arrays indexed by r * cols + c and reused across
+// queries. A cell's g and parent are valid only while its stamp equals the
+// current generation (and it is closed while closed[] does), so starting a
+// new search is O(1) instead of clearing every array. The open list is a
+// binary heap, or a BucketQueue when use_buckets is set and the search
+// gives its largest step cost.
+struct SearchContext {
+    vector<int> g, parent;
+    vector<unsigned> stamp, closed;
+    unsigned generation = 0;
+    vector<PQItem> open;   // heap storage, kept between searches
+    BucketQueue buckets;
+    bool use_buckets = false, bucketed = false;
+    long long expanded = 0;
+
+    void begin(int cells, int max_step = 0) {
+        if ((int)stamp.size() != cells) {
+            g.assign(cells, 0); parent.assign(cells, -1);
+            stamp.assign(cells, 0); closed.assign(cells, 0);
+            generation = 0;
+        }
+        if (++generation == 0) { // wrapped: clear once every 2^32 searches
+            fill(stamp.begin(), stamp.end(), 0);
+            fill(closed.begin(), closed.end(), 0);
+            generation = 1;
+        }
+        open.clear();
+        bucketed = use_buckets && max_step > 0;
+        if (bucketed) buckets.reset(max_step);
+    }
+    bool seen(int i) const { return stamp[i] == generation; }
+    bool is_closed(int i) const { return closed[i] == generation; }
+    void set(int i, int gi, int from) { stamp[i] = generation; g[i] = gi; parent[i] = from; }
+    bool empty() const { return bucketed ? buckets.count == 0 : open.empty(); }
+    void push(PQItem item) {
+        if (bucketed) { buckets.push(item); return; }
+        open.push_back(item); push_heap(open.begin(), open.end(), greater<PQItem>());
+    }
+    PQItem pop() {
+        if (bucketed) return buckets.pop();
+        pop_heap(open.begin(), open.end(), greater<PQItem>()); PQItem t = open.back(); open.pop_back(); return t;
+    }
+};
+
+vector<P> reconstruct_path(const Grid& grid, const SearchContext& ctx, int current) {
+    vector<P> total_path;
+    for (; current != -1; current = ctx.parent[current]) total_path.push_back(grid.pos(current));
     reverse(total_path.begin(), total_path.end());
     return total_path;
 }
 
-int heuristic(P a, P b) {
-    return abs(a.first - b.first) + abs(a.second - b.second); // Manhattan distance
+// Step costs in fixed point: 99/70 matches sqrt(2) to within 5e-5, so
+// 8-connected path costs stay integers. Printed costs divide by STRAIGHT.
+const int STRAIGHT = 70, DIAGONAL = 99;
+
+// Directions clockwise from north; even ones are straight, odd ones diagonal.
+const int DR[8] = {-1, -1, 0, 1, 1, 1, 0, -1}, DC[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+
+int direction(int dr, int dc) {
+    for (int d = 0; d < 8; d++) if (DR[d] == dr && DC[d] == dc) return d;
+    return -1;
 }
 
-bool AStar(vector<vector<int>>& grid, P start, P goal) {
-    int rows = grid.size(), cols = grid[0].size();
+int heuristic(P a, P b, bool diagonal = false) {
+    int dr = abs(a.first - b.first), dc = abs(a.second - b.second);
+    if (!diagonal) return STRAIGHT * (dr + dc);                           // Manhattan distance
+    return STRAIGHT * max(dr, dc) + (DIAGONAL - STRAIGHT) * min(dr, dc); // octile distance
+}
 
-    priority_queue<PQItem, vector<PQItem>, greater<PQItem>> open;
-    unordered_map<P, int, PairHash> gScore;
-    unordered_map<P, P, PairHash> cameFrom;
-    unordered_set<P, PairHash> closed;
+// A diagonal step needs both cells it passes between to be free (no corner cutting).
+bool can_step(const Grid& grid, int r, int c, int d) {
+    if (!grid.passable(r + DR[d], c + DC[d])) return false;
+    return !(d & 1) || (grid.passable(r + DR[d], c) && grid.passable(r, c + DC[d]));
+}
 
-    gScore[start] = 0;
-    open.push({heuristic(start, goal), 0, start});
+// Half-open block of cells [r0, r1) x [c0, c1).
+struct Rect {
+    int r0, c0, r1, c1;
+    bool contains(int r, int c) const { return r >= r0 && r < r1 && c >= c0 && c < c1; }
+};
 
-    vector<int> dir = {0,1,0,-1,0};
+void dijkstra_within(const Grid& grid, int source, const Rect& rect, bool diagonal, bool reverse, SearchContext& ctx);
 
-    while (!open.empty()) {
-        PQItem current = open.top();
-        open.pop();
+// ALT (A*, landmarks, triangle inequality): for a few landmark cells L we
+// store the distance from L to every cell and from every cell to L (they
+// differ on weighted maps), so d(v, t) >= d(L, t) - d(L, v) and
+// d(v, t) >= d(v, L) - d(t, L). The largest of these bounds is a consistent
+// heuristic, far tighter than the straight-line one around walls. Landmarks
+// are picked farthest-first, which spreads them along the map's fringes.
+struct Landmarks {
+    static constexpr int INF = INT_MAX;
+    int k = 0;
+    vector<int> picked;
+    vector<int> from, to;   // cell-major: from[v * k + l] = d(L_l, v), to[v * k + l] = d(v, L_l)
 
-        if (current.pos == goal) {
-            auto path = reconstruct_path(cameFrom, current.pos);
-            cout << "Path found:\n";
-            for (auto& p : path) {
-                cout << "(" << p.first << "," << p.second << ") ";
+    int bound(int v, int t) const {
+        const int *fv = &from[(size_t)v * k], *ft = &from[(size_t)t * k];
+        const int *tv = &to[(size_t)v * k], *tt = &to[(size_t)t * k];
+        int best = 0;
+        for (int l = 0; l < k; l++) {
+            if (fv[l] == INF || ft[l] == INF) continue; // other component
+            best = max(best, max(ft[l] - fv[l], tv[l] - tt[l]));
+        }
+        return best;
+    }
+    // The forward passes are sequential (each pick depends on the previous
+    // ones); the reverse passes run on up to threads threads.
+    void build(const Grid& grid, int count, bool diagonal, int threads = 1) {
+        int n = grid.size();
+        Rect all = {0, 0, grid.rows, grid.cols};
+        picked.clear();
+        SearchContext ctx;
+        // seed the picks in the largest connected region, which most queries use
+        vector<char> covered(n, 0);
+        vector<int> stack;
+        int seed = -1, largest = 0;
+        for (int v = 0; v < n; v++) {
+            if (grid.blocked(v) || covered[v]) continue;
+            int reached = 0;
+            covered[v] = 1; stack.assign(1, v);
+            while (!stack.empty()) {
+                int u = stack.back(); stack.pop_back(); reached++;
+                P p = grid.pos(u);
+                for (int d = 0; d < 8; d += diagonal ? 1 : 2) {
+                    if (!can_step(grid, p.first, p.second, d)) continue;
+                    int w = u + DR[d] * grid.cols + DC[d];
+                    if (!covered[w]) { covered[w] = 1; stack.push_back(w); }
+                }
             }
-            cout << endl;
-            return true;
+            if (reached > largest) { largest = reached; seed = v; }
+        }
+        k = seed >= 0 ? count : 0;
+        from.assign((size_t)n * k, INF); to.assign((size_t)n * k, INF);
+        if (!k) return;
+        vector<int> nearest(n, INF);   // distance to the closest landmark so far
+        dijkstra_within(grid, seed, all, diagonal, false, ctx);
+        for (int v = 0; v < n; v++) if (ctx.is_closed(v)) nearest[v] = ctx.g[v];
+        for (int l = 0; l < k; l++) {
+            int far = seed;
+            for (int v = 0; v < n; v++)
+                if (nearest[v] != INF && nearest[v] > nearest[far]) far = v;
+            picked.push_back(far);
+            dijkstra_within(grid, far, all, diagonal, false, ctx);
+            for (int v = 0; v < n; v++)
+                if (ctx.is_closed(v)) { from[(size_t)v * k + l] = ctx.g[v]; nearest[v] = min(nearest[v], ctx.g[v]); }
         }
+        atomic<int> next(0);
+        auto work = [&]() {
+            SearchContext local;
+            for (int l; (l = next++) < k;) {
+                dijkstra_within(grid, picked[l], all, diagonal, true, local);
+                for (int v = 0; v < n; v++)
+                    if (local.is_closed(v)) to[(size_t)v * k + l] = local.g[v];
+            }
+        };
+        vector<thread> pool;
+        for (int t = 1; t < min(threads, k); t++) pool.emplace_back(work);
+        work();
+        for (auto& th : pool) th.join();
+    }
+};
+
+// Returns the path cost, or -1 if goal is unreachable; fills path if given.
+// The heuristic is scaled by the cheapest terrain so it stays admissible,
+// and raised to the landmark bound when alt is given.
+// With within set, the path may only use cells inside that block.
+int AStar(const Grid& grid, P start, P goal, SearchContext& ctx, vector<P>* path = nullptr, bool diagonal = false,
+          const Rect* within = nullptr, const Landmarks* alt = nullptr) {
+    int s = grid.index(start), t = grid.index(goal);
+    if (grid.blocked(s) || grid.blocked(t)) return -1;
+    ctx.begin(grid.size(), (diagonal ? DIAGONAL : STRAIGHT) * grid.max_cost);
+    ctx.set(s, 0, -1);
+    auto h = [&](int i, P p) {
+        int v = grid.min_cost * heuristic(p, goal, diagonal);
+        return alt ? max(v, alt->bound(i, t)) : v;
+    };
+    ctx.push({h(s, start), 0, s});
+
+    while (!ctx.empty()) {
+        PQItem current = ctx.pop();
 
-        if (closed.count(current.pos)) continue;
-        closed.insert(current.pos);
+        if (current.pos == t) {
+            if (path) *path = reconstruct_path(grid, ctx, t);
+            return current.g;
+        }
 
-        for (int i = 0; i < 4; i++) {
-            int nr = current.pos.first + dir[i];
-            int nc = current.pos.second + dir[i+1];
-            if (nr < 0 || nc < 0 || nr >= rows || nc >= cols || grid[nr][nc] == 1) continue;
+        if (ctx.is_closed(current.pos) || current.g > ctx.g[current.pos]) continue;
+        ctx.closed[current.pos] = ctx.generation;
+        ctx.expanded++;
 
-            P neighbor = {nr, nc};
-            int tentative_gScore = current.g + 1;
+        P cur = grid.pos(current.pos);
+        for (int d = 0; d < 8; d += diagonal ? 1 : 2) {
+            if (!can_step(grid, cur.first, cur.second, d)) continue;
+            int nr = cur.first + DR[d];
+            int nc = cur.second + DC[d];
+            if (within && !within->contains(nr, nc)) continue;
+            int neighbor = nr * grid.cols + nc;
 
-            if (!gScore.count(neighbor) || tentative_gScore < gScore[neighbor]) {
-                cameFrom[neighbor] = current.pos;
-                gScore[neighbor] = tentative_gScore;
-                int f = tentative_gScore + heuristic(neighbor, goal);
-                open.push({f, tentative_gScore, neighbor});
+            int tentative_gScore = current.g + (d & 1 ? DIAGONAL : STRAIGHT) * grid.cells[neighbor];
+
+            if (!ctx.seen(neighbor) || tentative_gScore < ctx.g[neighbor]) {
+                ctx.set(neighbor, tentative_gScore, current.pos);
+                int f = tentative_gScore + h(neighbor, {nr, nc});
+                ctx.push({f, tentative_gScore, neighbor});
             }
         }
     }
+    return -1;
+}
+
+// Jump Point Search. Only jump points enter the open list: cells where an
+// optimal path may have to turn. Paths are canonical: diagonal moves come
+// before straight ones (8-connected) and vertical before horizontal
+// (4-connected), so from a cell reached in direction d only these
+// directions are searched:
+//   start: all;  diagonal d: d and its two straight parts;
+//   straight d: d, plus a perpendicular side (and, 8-connected, the diagonal
+//   between) whose cell is free while the cell beside the previous one is
+//   blocked - a forced neighbour;  4-connected vertical d: d, east and west.
+// A straight jump stops at a cell with a forced neighbour; a diagonal (or
+// 4-connected vertical) jump stops where one of its straight parts would.
+
+// Side s of a cell entered going d is forced when free but blocked one step back.
+bool forced(const Grid& grid, int r, int c, int d, int s) {
+    return grid.passable(r + DR[s], c + DC[s]) && !grid.passable(r + DR[s] - DR[d], c + DC[s] - DC[d]);
+}
+
+// True if moving in d turns at nothing but walls; false for the directions
+// that look sideways at every step (diagonals, and vertical when 4-connected).
+bool is_straight(int d, bool diagonal) { return !(d & 1) && (diagonal || d == 2 || d == 6); }
 
-    cout << "No path found." << endl;
-    return false;
+// The straight parts a composite direction looks along at every step.
+void parts(int d, int& a, int& b) {
+    if (d & 1) { a = d - 1; b = (d + 1) & 7; }
+    else { a = 2; b = 6; } // 4-connected vertical
 }
 
-int main() {
-    vector<vector<int>> grid = {
+int successor_dirs(const Grid& grid, int r, int c, int arrived, bool diagonal, int* out) {
+    int n = 0;
+    if (arrived < 0) {
+        for (int d = 0; d < 8; d += diagonal ? 1 : 2) out[n++] = d;
+    } else if (!is_straight(arrived, diagonal)) {
+        int a, b;
+        parts(arrived, a, b);
+        out[n++] = arrived; out[n++] = a; out[n++] = b;
+    } else {
+        out[n++] = arrived;
+        for (int s : {(arrived + 2) & 7, (arrived + 6) & 7}) {
+            if (!forced(grid, r, c, arrived, s)) continue;
+            out[n++] = s;
+            if (diagonal) out[n++] = s == ((arrived + 2) & 7) ? arrived + 1 : (arrived + 7) & 7;
+        }
+    }
+    return n;
+}
+
+// Walks from (r, c) in direction d; returns the first jump point or the goal
+// (with steps set to its distance), or -1 on reaching a wall first.
+int jump(const Grid& grid, int r, int c, int d, int goal, bool diagonal, int& steps) {
+    steps = 0;
+    while (can_step(grid, r, c, d)) {
+        r += DR[d]; c += DC[d]; steps++;
+        int i = r * grid.cols + c;
+        if (i == goal) return i;
+        if (is_straight(d, diagonal)) {
+            if (forced(grid, r, c, d, (d + 2) & 7) || forced(grid, r, c, d, (d + 6) & 7)) return i;
+        } else {
+            int a, b, k;
+            parts(d, a, b);
+            if (jump(grid, r, c, a, goal, diagonal, k) >= 0 || jump(grid, r, c, b, goal, diagonal, k) >= 0) return i;
+        }
+    }
+    return -1;
+}
+
+// JPS+ precomputes every jump: dist[cell * 8 + d] is the number of steps to
+// the next jump point in direction d (> 0), or minus the number of free steps
+// before a wall (<= 0). The goal is not known in advance, so a search also
+// stops a jump on the goal's row or column when it passes it (see jps_plus).
+struct JumpTable {
+    bool diagonal = false;
+    vector<int> dist;
+
+    int at(int cell, int d) const { return dist[cell * 8 + d]; }
+    void build(const Grid& grid, bool diag) {
+        diagonal = diag;
+        dist.assign(grid.size() * 8, 0);
+        // straight directions first: the composite ones are built from them
+        for (int pass = 0; pass < 2; pass++)
+            for (int d = 0; d < 8; d += diagonal ? 1 : 2) {
+                if (is_straight(d, diagonal) != (pass == 0)) continue;
+                int a = 0, b = 0;
+                if (pass == 1) parts(d, a, b);
+                // visit each cell after the one it steps to
+                int rs = DR[d] > 0 ? -1 : 1, cs = DC[d] > 0 ? -1 : 1;
+                for (int i = 0, r = rs > 0 ? 0 : grid.rows - 1; i < grid.rows; i++, r += rs)
+                    for (int j = 0, c = cs > 0 ? 0 : grid.cols - 1; j < grid.cols; j++, c += cs) {
+                        int cell = r * grid.cols + c;
+                        if (grid.blocked(cell) || !can_step(grid, r, c, d)) continue;
+                        int nr = r + DR[d], nc = c + DC[d], next = nr * grid.cols + nc;
+                        bool jp = pass == 0 ? forced(grid, nr, nc, d, (d + 2) & 7) || forced(grid, nr, nc, d, (d + 6) & 7)
+                                            : at(next, a) > 0 || at(next, b) > 0;
+                        int v = at(next, d);
+                        dist[cell * 8 + d] = jp ? 1 : v > 0 ? v + 1 : v - 1;
+                    }
+            }
+    }
+};
+
+// A* over jump points; expand(cell, arrived, emit) reports each successor as
+// emit(cell, steps, direction). Edges are straight or diagonal lines, so the
+// grid must have uniform cost (every cell costs grid.min_cost). Jumps can be
+// long, so the open list is always the heap.
+template<class Expand>
+int jump_search(const Grid& grid, P start, P goal, SearchContext& ctx, vector<P>* path, bool diagonal, Expand expand) {
+    int s = grid.index(start), t = grid.index(goal);
+    if (grid.blocked(s) || grid.blocked(t)) return -1;
+    ctx.begin(grid.size());
+    ctx.set(s, 0, -1);
+    ctx.push({grid.min_cost * heuristic(start, goal, diagonal), 0, s});
+
+    while (!ctx.empty()) {
+        PQItem current = ctx.pop();
+
+        if (current.pos == t) {
+            if (path) {
+                vector<P> jumps = reconstruct_path(grid, ctx, t);
+                path->assign(1, jumps[0]);
+                for (size_t i = 1; i < jumps.size(); i++) {
+                    P p = jumps[i - 1];
+                    int dr = (jumps[i].first > p.first) - (jumps[i].first < p.first);
+                    int dc = (jumps[i].second > p.second) - (jumps[i].second < p.second);
+                    while (p != jumps[i]) { p.first += dr; p.second += dc; path->push_back(p); }
+                }
+            }
+            return current.g;
+        }
+
+        if (ctx.is_closed(current.pos) || current.g > ctx.g[current.pos]) continue;
+        ctx.closed[current.pos] = ctx.generation;
+        ctx.expanded++;
+
+        int arrived = -1;
+        if (ctx.parent[current.pos] >= 0) {
+            P a = grid.pos(ctx.parent[current.pos]), b = grid.pos(current.pos);
+            arrived = direction((b.first > a.first) - (b.first < a.first), (b.second > a.second) - (b.second < a.second));
+        }
+        expand(current.pos, arrived, [&](int neighbor, int steps, int d) {
+            int tentative_gScore = current.g + steps * (d & 1 ? DIAGONAL : STRAIGHT) * grid.min_cost;
+            if (!ctx.seen(neighbor) || tentative_gScore < ctx.g[neighbor]) {
+                ctx.set(neighbor, tentative_gScore, current.pos);
+                int f = tentative_gScore + grid.min_cost * heuristic(grid.pos(neighbor), goal, diagonal);
+                ctx.push({f, tentative_gScore, neighbor});
+            }
+        });
+    }
+    return -1;
+}
+
+int JPS(const Grid& grid, P start, P goal, SearchContext& ctx, vector<P>* path = nullptr, bool diagonal = false) {
+    int t = grid.index(goal);
+    return jump_search(grid, start, goal, ctx, path, diagonal, [&](int cell, int arrived, auto emit) {
+        P p = grid.pos(cell);
+        int dirs[8], steps;
+        int n = successor_dirs(grid, p.first, p.second, arrived, diagonal, dirs);
+        for (int i = 0; i < n; i++) {
+            int next = jump(grid, p.first, p.second, dirs[i], t, diagonal, steps);
+            if (next >= 0) emit(next, steps, dirs[i]);
+        }
+    });
+}
+
+// Same search with jumps read from the table. A jump that passes the goal's
+// row or column (or, for a straight jump, the goal itself) stops there
+// instead, since the table's jump points ignore the goal.
+int JPSPlus(const Grid& grid, const JumpTable& table, P start, P goal, SearchContext& ctx, vector<P>* path = nullptr) {
+    bool diagonal = table.diagonal;
+    return jump_search(grid, start, goal, ctx, path, diagonal, [&](int cell, int arrived, auto emit) {
+        P p = grid.pos(cell);
+        int dr = goal.first - p.first, dc = goal.second - p.second;
+        int dirs[8];
+        int n = successor_dirs(grid, p.first, p.second, arrived, diagonal, dirs);
+        for (int i = 0; i < n; i++) {
+            int d = dirs[i], k = table.at(cell, d), reach = abs(k);
+            // steps along d to the goal's row or column, if it lies ahead within reach
+            bool ahead_r = DR[d] ? (dr > 0) == (DR[d] > 0) && dr != 0 : dr == 0;
+            bool ahead_c = DC[d] ? (dc > 0) == (DC[d] > 0) && dc != 0 : dc == 0;
+            int m = 0;
+            if (is_straight(d, diagonal)) {
+                if (ahead_r && ahead_c) m = DR[d] ? abs(dr) : abs(dc);
+            } else if (d & 1) {
+                if (ahead_r && ahead_c) m = min(abs(dr), abs(dc));
+            } else if (ahead_r) {
+                m = abs(dr); // 4-connected vertical
+            }
+            if (m > 0 && m <= reach) emit(cell + m * (DR[d] * grid.cols + DC[d]), m, d);
+            else if (k > 0) emit(cell + k * (DR[d] * grid.cols + DC[d]), k, d);
+        }
+    });
+}
+
+// Dijkstra from source to every cell of a block; afterwards ctx.g[i] is the
+// distance of each cell i with ctx.is_closed(i). With reverse set it is the
+// distance from i to source instead (a step costs the cell it enters, so
+// the two differ on weighted maps).
+void dijkstra_within(const Grid& grid, int source, const Rect& rect, bool diagonal, bool reverse, SearchContext& ctx) {
+    ctx.begin(grid.size());
+    ctx.set(source, 0, -1);
+    ctx.push({0, 0, source});
+    while (!ctx.empty()) {
+        PQItem current = ctx.pop();
+        if (ctx.is_closed(current.pos) || current.g > ctx.g[current.pos]) continue;
+        ctx.closed[current.pos] = ctx.generation;
+        P cur = grid.pos(current.pos);
+        for (int d = 0; d < 8; d += diagonal ? 1 : 2) {
+            if (!can_step(grid, cur.first, cur.second, d)) continue;
+            int nr = cur.first + DR[d], nc = cur.second + DC[d];
+            if (!rect.contains(nr, nc)) continue;
+            int neighbor = nr * grid.cols + nc;
+            int g = current.g + (d & 1 ? DIAGONAL : STRAIGHT) * grid.cells[reverse ? current.pos : neighbor];
+            if (!ctx.seen(neighbor) || g < ctx.g[neighbor]) {
+                ctx.set(neighbor, g, current.pos);
+                ctx.push({g, g, neighbor});
+            }
+        }
+    }
+}
+
+// HPA*: the grid is cut into square clusters. Along each border between two
+// clusters, every maximal run of cell pairs free on both sides is an
+// entrance with one transition (a straight step across) in its middle, or
+// one at each end if it is long. The cells on either side of a transition
+// are abstract nodes. Nodes of one cluster are linked by their exact
+// shortest distance inside the cluster, so a query is a small A* over the
+// abstract graph, with the start and goal linked into their clusters for
+// that query only. The result is a list of waypoints; refine() turns one
+// leg at a time into cells with an A* confined to its cluster, so a caller
+// can walk the first legs before the rest are computed. Paths are optimal
+// within this abstraction but not on the grid: every leg passes through
+// entrance cells, and how far the cost can exceed the true optimum depends
+// on the cluster size and the map.
+// set_cost() changes a cell and rebuilds only its cluster: the entrances on
+// its four borders and its own links, plus links for any node the new
+// entrances add to a neighbouring cluster.
+struct HPAStar {
+    struct Edge { int to, cost; bool inter; };
+    struct Node { int cell, refs; }; // refs: transitions using the node
+    struct Path { vector<int> cells; vector<char> inter; int cost = -1; };
+
+    Grid grid;
+    int size = 16;
+    bool diagonal = false;
+    int crows = 0, ccols = 0;
+    vector<Node> nodes;
+    vector<vector<Edge>> adj;
+    vector<int> node_of;                 // per cell: node ID or -1
+    vector<vector<int>> members;         // per cluster: its node IDs
+    vector<int> free_ids;
+    SearchContext local, top;
+
+    int cluster_of(int cell) const { P p = grid.pos(cell); return (p.first / size) * ccols + p.second / size; }
+    Rect rect(int k) const {
+        int r0 = (k / ccols) * size, c0 = (k % ccols) * size;
+        return {r0, c0, min(r0 + size, grid.rows), min(c0 + size, grid.cols)};
+    }
+
+    void build(const Grid& g, int cluster_size, bool diag) {
+        grid = g; size = cluster_size; diagonal = diag;
+        crows = (grid.rows + size - 1) / size; ccols = (grid.cols + size - 1) / size;
+        nodes.clear(); adj.clear(); free_ids.clear();
+        node_of.assign(grid.size(), -1);
+        members.assign(crows * ccols, {});
+        for (int k = 0; k < crows * ccols; k++) {
+            if (k % ccols + 1 < ccols) add_entrances(k, true, nullptr);
+            if (k / ccols + 1 < crows) add_entrances(k, false, nullptr);
+        }
+        for (int k = 0; k < crows * ccols; k++) link_cluster(k);
+    }
+
+    int get_node(int cell, vector<int>* created) {
+        if (node_of[cell] >= 0) return node_of[cell];
+        int id;
+        if (!free_ids.empty()) { id = free_ids.back(); free_ids.pop_back(); nodes[id] = {cell, 0}; adj[id].clear(); }
+        else { id = nodes.size(); nodes.push_back({cell, 0}); adj.emplace_back(); }
+        node_of[cell] = id;
+        members[cluster_of(cell)].push_back(id);
+        if (created) created->push_back(id);
+        return id;
+    }
+    void add_transition(int a, int b, vector<int>* created) {
+        int x = get_node(a, created), y = get_node(b, created);
+        adj[x].push_back({y, STRAIGHT * grid.cells[b], true});
+        adj[y].push_back({x, STRAIGHT * grid.cells[a], true});
+        nodes[x].refs++; nodes[y].refs++;
+    }
+    // Entrances on the border between cluster k and the cluster to its
+    // right (right set) or below it. The caller says which: with one column
+    // of clusters the one below is also k + 1.
+    void add_entrances(int k, bool right, vector<int>* created) {
+        Rect a = rect(k);
+        int len = right ? a.r1 - a.r0 : a.c1 - a.c0;
+        auto pair_at = [&](int i, int& x, int& y) {
+            if (right) { x = (a.r0 + i) * grid.cols + a.c1 - 1; y = x + 1; }
+            else { x = (a.r1 - 1) * grid.cols + a.c0 + i; y = x + grid.cols; }
+            return !grid.blocked(x) && !grid.blocked(y);
+        };
+        for (int i = 0, x, y; i < len;) {
+            if (!pair_at(i, x, y)) { i++; continue; }
+            int j = i;
+            while (j + 1 < len && pair_at(j + 1, x, y)) j++;
+            if (j - i + 1 >= 6) {
+                pair_at(i, x, y); add_transition(x, y, created);
+                pair_at(j, x, y); add_transition(x, y, created);
+            } else {
+                pair_at((i + j) / 2, x, y); add_transition(x, y, created);
+            }
+            i = j + 1;
+        }
+    }
+    // Intra-cluster links from node x to the others of its cluster, and
+    // (with both set) from them to x.
+    void link_node(int x, bool from_others, const vector<int>* skip) {
+        int k = cluster_of(nodes[x].cell);
+        Rect r = rect(k);
+        dijkstra_within(grid, nodes[x].cell, r, diagonal, false, local);
+        for (int y : members[k])
+            if (y != x && local.is_closed(nodes[y].cell)) adj[x].push_back({y, local.g[nodes[y].cell], false});
+        if (!from_others) return;
+        dijkstra_within(grid, nodes[x].cell, r, diagonal, true, local);
+        for (int y : members[k]) {
+            if (y == x || !local.is_closed(nodes[y].cell)) continue;
+            if (skip && find(skip->begin(), skip->end(), y) != skip->end()) continue;
+            adj[y].push_back({x, local.g[nodes[y].cell], false});
+        }
+    }
+    void link_cluster(int k) {
+        for (int x : members[k]) link_node(x, false, nullptr);
+    }
+    void drop_edges_to(int x, int y) {
+        auto& e = adj[x];
+        e.erase(remove_if(e.begin(), e.end(), [&](const Edge& ed) { return ed.to == y; }), e.end());
+    }
+    void remove_node(int x) {
+        int k = cluster_of(nodes[x].cell);
+        for (int y : members[k]) if (y != x) drop_edges_to(y, x);
+        members[k].erase(find(members[k].begin(), members[k].end(), x));
+        node_of[nodes[x].cell] = -1;
+        adj[x].clear();
+        free_ids.push_back(x);
+    }
+
+    void set_cost(int r, int c, int cost) {
+        grid.cells[r * grid.cols + c] = cost;
+        if (cost) grid.min_cost = min(grid.min_cost, cost), grid.max_cost = max(grid.max_cost, cost);
+        rebuild_cluster(cluster_of(r * grid.cols + c));
+    }
+    void rebuild_cluster(int k) {
+        // drop the cluster's nodes, their transitions, and neighbour nodes
+        // that no other transition uses
+        vector<int> old = members[k];
+        for (int x : old)
+            for (auto& e : adj[x]) {
+                if (!e.inter) continue;
+                drop_edges_to(e.to, x);
+                if (--nodes[e.to].refs == 0) remove_node(e.to);
+            }
+        for (int x : old) remove_node(x);
+        vector<int> created;
+        int kr = k / ccols, kc = k % ccols;
+        if (kc > 0) add_entrances(k - 1, true, &created);
+        if (kc + 1 < ccols) add_entrances(k, true, &created);
+        if (kr > 0) add_entrances(k - ccols, false, &created);
+        if (kr + 1 < crows) add_entrances(k, false, &created);
+        link_cluster(k);
+        // new nodes in neighbouring clusters: link them both ways, new-to-new once
+        vector<int> outside;
+        for (int x : created) if (cluster_of(nodes[x].cell) != k) outside.push_back(x);
+        for (int x : outside) link_node(x, true, &outside);
+    }
+
+    // Abstract search; returns the waypoints (start, nodes..., goal).
+    Path query(P start, P goal) {
+        Path result;
+        int s = grid.index(start), t = grid.index(goal);
+        if (grid.blocked(s) || grid.blocked(t)) return result;
+        if (s == t) { result.cells = {s}; result.cost = 0; return result; }
+        // temporary nodes for start and goal unless they already are nodes
+        int sn = node_of[s], tn = node_of[t];
+        int base = nodes.size();
+        vector<int> patched; // nodes given a temporary edge to the goal
+        auto add_temp = [&](int cell) { nodes.push_back({cell, 0}); adj.emplace_back(); return (int)nodes.size() - 1; };
+        if (sn < 0) {
+            sn = add_temp(s);
+            int k = cluster_of(s);
+            dijkstra_within(grid, s, rect(k), diagonal, false, local);
+            for (int y : members[k]) if (local.is_closed(nodes[y].cell)) adj[sn].push_back({y, local.g[nodes[y].cell], false});
+        }
+        if (tn < 0) {
+            tn = add_temp(t);
+            int k = cluster_of(t);
+            dijkstra_within(grid, t, rect(k), diagonal, true, local);
+            for (int y : members[k]) if (local.is_closed(nodes[y].cell)) { adj[y].push_back({tn, local.g[nodes[y].cell], false}); patched.push_back(y); }
+            if (sn >= base && cluster_of(s) == k && local.is_closed(s)) adj[sn].push_back({tn, local.g[s], false});
+        }
+        int n = nodes.size();
+        top.begin(n);
+        top.set(sn, 0, -1);
+        top.push({grid.min_cost * heuristic(start, goal, diagonal), 0, sn});
+        vector<char> via_inter(n, 0);
+        while (!top.empty()) {
+            PQItem current = top.pop();
+            if (current.pos == tn) { result.cost = current.g; break; }
+            if (top.is_closed(current.pos) || current.g > top.g[current.pos]) continue;
+            top.closed[current.pos] = top.generation;
+            top.expanded++;
+            for (auto& e : adj[current.pos]) {
+                int g = current.g + e.cost;
+                if (!top.seen(e.to) || g < top.g[e.to]) {
+                    top.set(e.to, g, current.pos);
+                    via_inter[e.to] = e.inter;
+                    top.push({g + grid.min_cost * heuristic(grid.pos(nodes[e.to].cell), goal, diagonal), g, e.to});
+                }
+            }
+        }
+        if (result.cost >= 0) {
+            for (int x = tn; x != -1; x = top.parent[x]) { result.cells.push_back(nodes[x].cell); result.inter.push_back(via_inter[x]); }
+            reverse(result.cells.begin(), result.cells.end());
+            reverse(result.inter.begin(), result.inter.end());
+            result.inter.erase(result.inter.begin()); // inter[i]: leg from cells[i] to cells[i + 1]
+        }
+        for (int y : patched) adj[y].pop_back();
+        nodes.resize(base); adj.resize(base);
+        return result;
+    }
+    // Cells of leg i (from cells[i] to cells[i + 1]), without its first cell.
+    vector<P> refine(const Path& path, size_t i) {
+        int a = path.cells[i], b = path.cells[i + 1];
+        if (path.inter[i]) return {grid.pos(b)};
+        vector<P> leg;
+        Rect r = rect(cluster_of(a));
+        AStar(grid, grid.pos(a), grid.pos(b), local, &leg, diagonal, &r);
+        leg.erase(leg.begin());
+        return leg;
+    }
+    int find_path(P start, P goal, vector<P>* path = nullptr) {
+        Path p = query(start, goal);
+        if (path && p.cost >= 0) {
+            path->assign(1, start);
+            for (size_t i = 0; i + 1 < p.cells.size(); i++) {
+                vector<P> leg = refine(p, i);
+                path->insert(path->end(), leg.begin(), leg.end());
+            }
+        }
+        return p.cost;
+    }
+};
+
+// D* Lite: searches from the goal towards the start and keeps g (distance to
+// the goal) and rhs (the one-step lookahead of g) for every cell between
+// calls. A cell is consistent when g == rhs; only inconsistent cells sit in
+// the open list, keyed by [min(g, rhs) + h(start, cell) + km, min(g, rhs)].
+// set_cost() makes the cells around a changed one re-derive rhs, and
+// move_start() raises km instead of re-keying the open list, so plan()
+// repairs only the part of the search the change reaches. The heuristic
+// assumes the cheapest possible terrain (cost 1) so it stays admissible
+// whatever the changes.
+struct DStarLite {
+    static constexpr int INF = INT_MAX / 4;
+    struct Entry {
+        long long k1, k2;
+        int cell;
+        bool operator>(const Entry& o) const { return k1 > o.k1 || (k1 == o.k1 && k2 > o.k2); }
+    };
+
+    Grid grid;
+    bool diagonal = false;
+    int start = 0, goal = 0, last = 0;
+    long long km = 0, expanded = 0;
+    vector<int> g, rhs;
+    vector<Entry> open;          // heap; an entry is live only if it matches key_of
+    vector<pair<long long,long long>> key_of;
+    vector<char> queued;
+
+    int h(int a, int b) const { return heuristic(grid.pos(a), grid.pos(b), diagonal); }
+    pair<long long,long long> key(int s) const {
+        long long m = min(g[s], rhs[s]);
+        return {m + h(start, s) + km, m};
+    }
+    void push(int s) {
+        key_of[s] = key(s); queued[s] = 1;
+        open.push_back({key_of[s].first, key_of[s].second, s});
+        push_heap(open.begin(), open.end(), greater<Entry>());
+    }
+    // drop stale entries from the top of the heap
+    bool top(Entry& e) {
+        while (!open.empty()) {
+            e = open.front();
+            if (queued[e.cell] && key_of[e.cell] == make_pair(e.k1, e.k2)) return true;
+            pop_heap(open.begin(), open.end(), greater<Entry>()); open.pop_back();
+        }
+        return false;
+    }
+    // successors v of u with the cost of stepping u -> v
+    template<class F> void for_succ(int u, F f) const {
+        P p = grid.pos(u);
+        for (int d = 0; d < 8; d += diagonal ? 1 : 2)
+            if (can_step(grid, p.first, p.second, d)) {
+                int v = u + DR[d] * grid.cols + DC[d];
+                f(v, (d & 1 ? DIAGONAL : STRAIGHT) * grid.cells[v]);
+            }
+    }
+    // predecessors u of v: on this grid, the cells that can step into v
+    template<class F> void for_pred(int v, F f) const {
+        if (grid.blocked(v)) return;
+        P p = grid.pos(v);
+        for (int d = 0; d < 8; d += diagonal ? 1 : 2)
+            if (can_step(grid, p.first, p.second, d)) f(v + DR[d] * grid.cols + DC[d]);
+    }
+    void update_vertex(int u) {
+        if (u != goal) {
+            int best = INF;
+            if (!grid.blocked(u)) for_succ(u, [&](int v, int c) { if (g[v] < INF) best = min(best, c + g[v]); });
+            rhs[u] = best;
+        }
+        queued[u] = 0;
+        if (g[u] != rhs[u]) push(u);
+    }
+
+    void init(const Grid& map, P s, P t, bool diag) {
+        grid = map; diagonal = diag;
+        start = last = grid.index(s); goal = grid.index(t);
+        km = 0;
+        g.assign(grid.size(), INF); rhs.assign(grid.size(), INF);
+        key_of.assign(grid.size(), {0, 0}); queued.assign(grid.size(), 0);
+        open.clear();
+        rhs[goal] = 0;
+        push(goal);
+    }
+    // Repairs the search; returns the cost from start to goal or -1.
+    int plan() {
+        Entry e;
+        while (top(e) && (make_pair(e.k1, e.k2) < key(start) || rhs[start] != g[start])) {
+            int u = e.cell;
+            pair<long long,long long> k_new = key(u);
+            pop_heap(open.begin(), open.end(), greater<Entry>()); open.pop_back();
+            queued[u] = 0;
+            if (make_pair(e.k1, e.k2) < k_new) {
+                push(u);                 // key went stale after the start moved
+                continue;
+            }
+            expanded++;
+            if (g[u] > rhs[u]) {
+                g[u] = rhs[u];
+                for_pred(u, [&](int p) { update_vertex(p); });
+            } else {
+                g[u] = INF;
+                update_vertex(u);
+                for_pred(u, [&](int p) { update_vertex(p); });
+            }
+        }
+        return rhs[start] < INF ? rhs[start] : -1;
+    }
+    void move_start(P s) {
+        start = grid.index(s);
+    }
+    void set_cost(P cell, int cost) {
+        int x = grid.index(cell);
+        if (grid.cells[x] == cost) return;
+        km += h(last, start); last = start;
+        grid.cells[x] = cost;
+        // every step whose cost or legality changed starts at x or a neighbour of x
+        update_vertex(x);
+        for (int d = 0; d < 8; d++)
+            if (grid.inside(cell.first + DR[d], cell.second + DC[d])) update_vertex(x + DR[d] * grid.cols + DC[d]);
+    }
+    // Follows the cheapest successor from start; empty if the goal is unreachable.
+    vector<P> path() const {
+        vector<P> out;
+        if (rhs[start] >= INF) return out;
+        for (int u = start; ; ) {
+            out.push_back(grid.pos(u));
+            if (u == goal) break;
+            int next = -1; long long best = INF;
+            for_succ(u, [&](int v, int c) { if (g[v] < INF && c + g[v] < best) { best = c + g[v]; next = v; } });
+            if (next < 0 || out.size() > (size_t)grid.size()) { out.clear(); break; }
+            u = next;
+        }
+        return out;
+    }
+};
+
+// MovingAI .map: "type", "height H", "width W", "map", then H rows of W chars.
+bool load_map(const string& file, Grid& grid) {
+    ifstream in(file);
+    if (!in) { cerr << "Cannot open " << file << "\n"; return false; }
+    string key;
+    int h = -1, w = -1;
+    while (in >> key && key != "map") {
+        if (key == "height") in >> h;
+        else if (key == "width") in >> w;
+        else if (key == "type") in >> key;
+    }
+    if (key != "map" || h <= 0 || w <= 0) { cerr << file << " is not a MovingAI map\n"; return false; }
+    grid.rows = h; grid.cols = w;
+    grid.cells.assign(h * w, 0);
+    string line;
+    for (int r = 0; r < h && in >> line; r++)
+        for (int c = 0; c < w && c < (int)line.size(); c++) {
+            char ch = line[c];
+            grid.cells[r * w + c] = (ch == '.' || ch == 'G' || ch == 'S') ? 1 : (ch >= '1' && ch <= '9') ? ch - '0' : 0;
+        }
+    grid.update_costs();
+    return true;
+}
+
+struct Scenario {
+    P start, goal;
+    double optimal; // length recorded in the .scen file (8-connected)
+};
+
+// MovingAI .scen: "version 1", then per query
+// bucket map width height start_x start_y goal_x goal_y optimal_length
+bool load_scen(const string& file, vector<Scenario>& out) {
+    ifstream in(file);
+    if (!in) { cerr << "Cannot open " << file << "\n"; return false; }
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line.compare(0, 7, "version") == 0) continue;
+        istringstream ss(line);
+        string bucket, map;
+        int w, h, sx, sy, gx, gy;
+        double opt;
+        if (ss >> bucket >> map >> w >> h >> sx >> sy >> gx >> gy >> opt)
+            out.push_back({{sy, sx}, {gy, gx}, opt});
+    }
+    return true;
+}
+
+void print_path(const vector<P>& path) {
+    cout << "Path found:\n";
+    for (auto& p : path) {
+        cout << "(" << p.first << "," << p.second << ") ";
+    }
+    cout << endl;
+}
+
+double cost_value(long long cost) { return double(cost) / STRAIGHT; }
+
+// Answers every query with A* on up to threads threads; each thread owns a
+// SearchContext and takes the next unanswered query from a shared counter.
+// costs[i] answers scen[i]; expanded (if given) gets the total expansions.
+vector<int> solve_batch(const Grid& grid, const vector<Scenario>& scen, bool diagonal, int threads,
+                        const Landmarks* alt = nullptr, long long* expanded = nullptr) {
+    vector<int> costs(scen.size(), -1);
+    atomic<size_t> next(0);
+    atomic<long long> total(0);
+    auto work = [&]() {
+        SearchContext ctx;
+        for (size_t i; (i = next++) < scen.size();)
+            costs[i] = AStar(grid, scen[i].start, scen[i].goal, ctx, nullptr, diagonal, nullptr, alt);
+        total += ctx.expanded;
+    };
+    vector<thread> pool;
+    for (int t = 1; t < threads && (size_t)t < scen.size(); t++) pool.emplace_back(work);
+    work();
+    for (auto& th : pool) th.join();
+    if (expanded) *expanded = total;
+    return costs;
+}
+
+// Builds HPA* on grid, answers every query with full refinement, then
+// times rebuilding one cluster after a cell change.
+void run_hpa(const Grid& grid, const vector<Scenario>& scen, bool diagonal, int cluster, const vector<int>& reference) {
+    HPAStar hpa;
+    auto t0 = chrono::steady_clock::now();
+    hpa.build(grid, cluster, diagonal);
+    auto since = [](chrono::steady_clock::time_point t) { return chrono::duration<double>(chrono::steady_clock::now() - t).count() * 1000; };
+    size_t edges = 0;
+    for (auto& e : hpa.adj) edges += e.size();
+    cout << "hpa: " << hpa.crows * hpa.ccols << " clusters, " << hpa.nodes.size() << " nodes, " << edges
+         << " edges, built in " << since(t0) << " ms\n";
+    t0 = chrono::steady_clock::now();
+    int found = 0;
+    long long total_cost = 0, optimal = 0;
+    vector<P> path;
+    for (size_t i = 0; i < scen.size(); i++) {
+        int cost = hpa.find_path(scen[i].start, scen[i].goal, &path);
+        if (cost >= 0) {
+            found++; total_cost += cost;
+            if (i < reference.size()) optimal += reference[i];
+        }
+    }
+    double ms = since(t0);
+    cout << "hpa: " << scen.size() << " queries, " << found << " solved, total cost " << fixed << setprecision(1)
+         << cost_value(total_cost) << ", " << hpa.top.expanded << " abstract expansions, " << setprecision(3) << ms << " ms\n";
+    if (optimal) cout << "  " << setprecision(2) << 100.0 * (total_cost - optimal) / optimal << "% above optimal\n";
+    cout.unsetf(ios::floatfield); cout.precision(6);
+    int r = grid.rows / 2, c = grid.cols / 2, old = grid.cells[r * grid.cols + c];
+    t0 = chrono::steady_clock::now();
+    hpa.set_cost(r, c, old ? 0 : 1);
+    hpa.set_cost(r, c, old);
+    cout << "hpa: toggling cell (" << r << "," << c << ") rebuilt its cluster twice in " << since(t0) << " ms\n";
+}
+
+// Walks each query's path; every 8 steps the cell 4 steps ahead becomes a
+// wall, and both D* Lite (repair) and A* (from scratch) replan from the
+// current cell. Their costs must agree.
+void run_dstar(const Grid& grid, const vector<Scenario>& scen, bool diagonal) {
+    DStarLite ds;
+    SearchContext ctx;
+    double init_ms = 0, repair_ms = 0, astar_ms = 0;
+    long long init_exp = 0, repair_exp = 0, astar_exp = 0;
+    int replans = 0, mismatches = 0;
+    auto ms = [](chrono::steady_clock::time_point t) { return chrono::duration<double>(chrono::steady_clock::now() - t).count() * 1000; };
+    for (auto& q : scen) {
+        if (grid.blocked(grid.index(q.start)) || grid.blocked(grid.index(q.goal))) continue;
+        auto t0 = chrono::steady_clock::now();
+        ds.init(grid, q.start, q.goal, diagonal);
+        ds.expanded = 0;
+        if (ds.plan() < 0) continue;
+        init_ms += ms(t0); init_exp += ds.expanded;
+        vector<P> path = ds.path();
+        for (int step = 1; path.size() > 1; step++) {
+            ds.move_start(path[1]);
+            if (step % 8 == 0 && path.size() > 6) {
+                ds.set_cost(path[5], 0);
+                ds.expanded = 0;
+                t0 = chrono::steady_clock::now();
+                int cost = ds.plan();
+                repair_ms += ms(t0); repair_exp += ds.expanded;
+                ctx.expanded = 0;
+                t0 = chrono::steady_clock::now();
+                int check = AStar(ds.grid, path[1], q.goal, ctx, nullptr, diagonal);
+                astar_ms += ms(t0); astar_exp += ctx.expanded;
+                replans++;
+                mismatches += cost != check;
+                if (cost < 0) break;
+            }
+            path = ds.path();
+        }
+    }
+    cout << "dstar: initial plans " << init_exp << " expansions, " << init_ms << " ms; " << replans << " replans:\n"
+         << "  D* Lite repair " << repair_exp << " expansions, " << repair_ms << " ms\n"
+         << "  A* from scratch " << astar_exp << " expansions, " << astar_ms << " ms\n";
+    if (mismatches) cout << "  " << mismatches << " replans disagree with A*\n";
+}
+
+int run_scenarios(const Grid& grid, const vector<Scenario>& scen, const string& algo, bool diagonal, int cluster,
+                  int landmarks, int threads) {
+    vector<string> algos = {algo};
+    if (algo == "all") {
+        algos = {"astar", "astar-bucket", "alt"};
+        if (grid.uniform()) { algos.push_back("jps"); algos.push_back("jps+"); }
+        algos.push_back("hpa");
+        algos.push_back("dstar");
+    } else if ((algo == "jps" || algo == "jps+") && !grid.uniform()) {
+        cerr << algo << " needs a map with uniform terrain cost\n"; return 1;
+    }
+    vector<int> reference;
+    for (auto& a : algos) {
+        if (a == "hpa") { run_hpa(grid, scen, diagonal, cluster, reference); continue; }
+        if (a == "dstar") { run_dstar(grid, scen, diagonal); continue; }
+        SearchContext ctx;
+        ctx.use_buckets = a == "astar-bucket";
+        JumpTable table;
+        Landmarks lm;
+        auto t0 = chrono::steady_clock::now();
+        if (a == "jps+" || a == "alt") {
+            if (a == "jps+") table.build(grid, diagonal);
+            else lm.build(grid, landmarks, diagonal, threads);
+            cout << a << (a == "alt" ? " landmarks" : " table") << " built in "
+                 << chrono::duration<double>(chrono::steady_clock::now() - t0).count() * 1000 << " ms\n";
+            t0 = chrono::steady_clock::now();
+        }
+        vector<int> costs;
+        if (a == "astar" || a == "alt") costs = solve_batch(grid, scen, diagonal, threads, a == "alt" ? &lm : nullptr, &ctx.expanded);
+        else for (auto& q : scen)
+            costs.push_back(a == "jps" ? JPS(grid, q.start, q.goal, ctx, nullptr, diagonal)
+                          : a == "jps+" ? JPSPlus(grid, table, q.start, q.goal, ctx)
+                          : AStar(grid, q.start, q.goal, ctx, nullptr, diagonal));
+        int found = 0;
+        long long total_cost = 0;
+        for (int cost : costs)
+            if (cost >= 0) { found++; total_cost += cost; }
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        cout << a << ": " << scen.size() << " queries, " << found << " solved, total cost " << fixed << setprecision(1)
+             << cost_value(total_cost) << ", " << ctx.expanded << " expansions, " << setprecision(3) << secs * 1000 << " ms\n";
+        cout.unsetf(ios::floatfield); cout.precision(6);
+        if (reference.empty()) reference = costs;
+        else if (costs != reference) {
+            size_t bad = 0;
+            for (size_t i = 0; i < costs.size(); i++) bad += costs[i] != reference[i];
+            cout << "  " << bad << " costs differ from " << algos[0] << "\n";
+        }
+    }
+    return 0;
+}
+
+// Regression check for HPA* on maps one cluster wide or one cluster high,
+// where the cluster below is also k + 1. Every refined path must be a walk
+// of legal moves whose cost matches the reported one and is no better than
+// A*; the same holds after cells are toggled and their clusters rebuilt.
+int hpa_selftest() {
+    unsigned seed = 12345;
+    auto rnd = [&](int n) { seed = seed * 1103515245u + 12345u; return int((seed >> 8) % n); };
+    auto walk_cost = [](const Grid& g, const vector<P>& path, bool diag) -> long long {
+        long long cost = 0;
+        for (size_t i = 1; i < path.size(); i++) {
+            P a = path[i - 1], b = path[i];
+            int dr = abs(a.first - b.first), dc = abs(a.second - b.second);
+            if (!g.passable(b.first, b.second) || dr > 1 || dc > 1 || dr + dc == 0) return -1;
+            if (dr + dc == 2 && (!diag || !g.passable(a.first, b.second) || !g.passable(b.first, a.second))) return -1;
+            cost += (dr + dc == 2 ? DIAGONAL : STRAIGHT) * g.cells[g.index(b)];
+        }
+        return cost;
+    };
+    int failures = 0, queries = 0;
+    for (int shape = 0; shape < 4; shape++)
+        for (int diag = 0; diag < 2; diag++) {
+            bool tall = shape % 2 == 0, walls = shape >= 2;
+            vector<vector<int>> rows(tall ? 24 : 6, vector<int>(tall ? 6 : 24, 0));
+            if (walls) for (auto& row : rows) for (int& v : row) v = rnd(5) == 0;
+            Grid grid(rows);
+            HPAStar hpa;
+            hpa.build(grid, 8, diag);
+            SearchContext ctx;
+            vector<P> path;
+            for (int round = 0; round < 6; round++) {
+                for (int q = 0; q < 100; q++) {
+                    P a = {rnd(grid.rows), rnd(grid.cols)}, b = {rnd(grid.rows), rnd(grid.cols)};
+                    int cost = hpa.find_path(a, b, &path), best = AStar(hpa.grid, a, b, ctx, nullptr, diag);
+                    queries++;
+                    bool ok = cost < 0 ? best < 0
+                            : best >= 0 && cost >= best && path.front() == a && path.back() == b
+                              && walk_cost(hpa.grid, path, diag) == cost;
+                    if (!ok && failures++ < 5)
+                        cout << "selftest: " << grid.rows << "x" << grid.cols << (diag ? " diag" : "") << " ("
+                             << a.first << "," << a.second << ") -> (" << b.first << "," << b.second << ") hpa "
+                             << cost << ", A* " << best << "\n";
+                }
+                int r = rnd(grid.rows), c = rnd(grid.cols);
+                hpa.set_cost(r, c, hpa.grid.blocked(hpa.grid.index({r, c})) ? 1 : 0);
+            }
+        }
+    cout << "selftest: " << queries << " hpa queries, " << failures << " failures\n";
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    Grid grid;
+    vector<string> args;
+    string algo = "astar";
+    bool diagonal = false;
+    int cluster = 16, landmarks = 8, threads = 1;
+    for (int i = 1; i < argc; i++) {
+        string a = argv[i];
+        if (a == "--diag") diagonal = true;
+        else if (a == "--cluster" && i + 1 < argc) cluster = max(2, atoi(argv[++i]));
+        else if (a == "--landmarks" && i + 1 < argc) landmarks = max(1, atoi(argv[++i]));
+        else if (a == "--threads" && i + 1 < argc) threads = max(1, atoi(argv[++i]));
+        else if (a == "astar" || a == "astar-bucket" || a == "alt" || a == "jps" || a == "jps+" || a == "hpa" || a == "dstar" || a == "all") algo = a;
+        else args.push_back(a);
+    }
+    if (args.size() == 1 && args[0] == "selftest") return hpa_selftest();
+    if (args.size() == 2 || args.size() == 5) {
+        if (!load_map(args[0], grid)) return 1;
+        if (args.size() == 2) {
+            vector<Scenario> scen;
+            if (!load_scen(args[1], scen)) return 1;
+            return run_scenarios(grid, scen, algo, diagonal, cluster, landmarks, threads);
+        }
+        P start = {stoi(args[1]), stoi(args[2])}, goal = {stoi(args[3]), stoi(args[4])};
+        if (!grid.inside(start.first, start.second) || !grid.inside(goal.first, goal.second)) {
+            cerr << "Start or goal outside the map\n"; return 1;
+        }
+        if ((algo == "jps" || algo == "jps+") && !grid.uniform()) {
+            cerr << algo << " needs a map with uniform terrain cost\n"; return 1;
+        }
+        SearchContext ctx;
+        ctx.use_buckets = algo == "astar-bucket";
+        vector<P> path;
+        JumpTable table;
+        HPAStar hpa;
+        DStarLite ds;
+        Landmarks lm;
+        if (algo == "jps+") table.build(grid, diagonal);
+        if (algo == "alt") lm.build(grid, landmarks, diagonal, threads);
+        if (algo == "hpa") hpa.build(grid, cluster, diagonal);
+        if (algo == "dstar") ds.init(grid, start, goal, diagonal);
+        int cost = algo == "hpa" ? hpa.find_path(start, goal, &path)
+                 : algo == "dstar" ? (grid.blocked(grid.index(start)) ? -1 : ds.plan())
+                 : algo == "jps" ? JPS(grid, start, goal, ctx, &path, diagonal)
+                 : algo == "jps+" ? JPSPlus(grid, table, start, goal, ctx, &path)
+                 : AStar(grid, start, goal, ctx, &path, diagonal, nullptr, algo == "alt" ? &lm : nullptr);
+        if (algo == "dstar" && cost >= 0) path = ds.path();
+        if (cost >= 0) { print_path(path); cout << "Cost: " << cost_value(cost) << "\n"; }
+        else cout << "No path found." << endl;
+        return 0;
+    }
+    if (!args.empty()) {
+        cout << "Usage: " << argv[0] << " [<file.map> <file.scen> | <file.map> sr sc gr gc | selftest] [astar|astar-bucket|alt|jps|jps+|hpa|dstar|all] [--diag] [--cluster N] [--landmarks K] [--threads T]\n"; return 1;
+    }
+
+    grid = Grid({
         {0,0,0,0,0},
         {1,1,0,1,0},
         {0,0,0,0,0},
         {0,1,1,1,0},
         {0,0,0,0,0}
-    };
+    });
 
     P start = {0,0};
     P goal = {4,4};
 
-    AStar(grid, start, goal);
+    SearchContext ctx;
+    vector<P> path;
+    if (AStar(grid, start, goal, ctx, &path) >= 0) print_path(path);
+    else cout << "No path found." << endl;
 
     return 0;
 }
@@ -1,32 +1,366 @@
 // eight_queens.cpp
+// N-Queens by bitmask backtracking. Columns and both diagonals under attack
+// are bitmasks (bit c = column c of the current row), so the free squares of
+// a row are one AND-NOT and the search takes them lowest bit first.
+//   a6 [N] [--count | --list | --list-unique] [--threads T]
+//   a6 N --min-conflicts [--seed S] [--list]
+// By default the solutions are also grouped into classes under the 8
+// symmetries of the board and the first three (in row order) are printed.
+// --count only counts, in O(N) memory. --list streams every solution, and
+// --list-unique one per class, as a line of column numbers (row 0 first),
+// in no particular order. N defaults to 8, at most 32.
+// The first rows are enumerated up front into independent tasks, which T
+// threads (default: all cores) share through a work-stealing pool.
+// --min-conflicts looks for one solution by local search instead (N up to
+// 10^8), checks it independently and prints it only with --list.
 #include <iostream>
 #include <vector>
+#include <deque>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <mutex>
+#include <thread>
+#include <random>
+#include <chrono>
 using namespace std;
 
 int N=8;
-vector<int> cols;
-vector<vector<int>> solutions;
+uint32_t full;                 // the N column bits
+vector<vector<int>> solutions; // the first few, for printing
 
-bool safe(int r,int c){
-    for(int i=0;i<r;i++){
-        if(cols[i]==c) return false;
-        if(abs(cols[i]-c)==r-i) return false;
+// Solutions below a partial board whose attacked squares in row r are
+// cols|ld|rd (ld/rd: diagonals moving left/right one column per row).
+long long count(int r, uint32_t used, uint32_t ld, uint32_t rd){
+    uint32_t avail=full & ~(used|ld|rd);
+    if(r==N-1) return __builtin_popcount(avail);
+    long long n=0;
+    while(avail){
+        uint32_t bit=avail & -avail;
+        avail^=bit;
+        n+=count(r+1, used|bit, (ld|bit)<<1, (rd|bit)>>1);
+    }
+    return n;
+}
+
+// Calls visit() with cols[r..] filled in for each solution below row r;
+// stops early (and returns true) once visit() returns true.
+template<class F> bool search(int r, uint32_t used, uint32_t ld, uint32_t rd, vector<int>& cols, F& visit){
+    if(r==N) return visit();
+    uint32_t avail=full & ~(used|ld|rd);
+    while(avail){
+        uint32_t bit=avail & -avail;
+        avail^=bit;
+        cols[r]=__builtin_ctz(bit);
+        if(search(r+1, used|bit, (ld|bit)<<1, (rd|bit)>>1, cols, visit)) return true;
+    }
+    return false;
+}
+
+// The 7 other images of a solution under rotation and reflection; t[k]
+// receives image k+1. A class is counted at its lexicographically smallest
+// member, whose first queen is always in the left half (or the middle).
+struct Classes {
+    long long total=0, unique=0, by_size[9]={};
+    vector<vector<int>> t;
+    Classes(): t(7, vector<int>(N)) {}
+    // true if q is the representative of its class
+    bool add(const vector<int>& q){
+        for(int r=0;r<N;r++){
+            int c=q[r], rr=N-1-r, cc=N-1-c;
+            t[0][c]=rr;  t[1][rr]=cc; t[2][cc]=r;  // rotations by 90, 180, 270
+            t[3][r]=cc;  t[4][rr]=c;               // mirror left-right, top-bottom
+            t[5][c]=r;   t[6][cc]=rr;              // the two diagonals
+        }
+        int same=1;
+        for(auto& img:t){
+            if(img<q) return false;
+            same+=img==q;
+        }
+        unique++;
+        by_size[8/same]++;
+        total+=8/same;
+        return true;
+    }
+    void merge(const Classes& o){
+        total+=o.total; unique+=o.unique;
+        for(int i=0;i<9;i++) by_size[i]+=o.by_size[i];
+    }
+};
+
+// A partial board: the queens of rows 0..row-1. Every solution is mirrored
+// by one whose first queen is in column N-1-c, so the first row only takes
+// the left half (and the middle), and weight says how many solutions each
+// one found below stands for: 2, or 1 below the middle column.
+struct Task {
+    int row, weight;
+    uint32_t used, ld, rd;
+    vector<int> cols;
+};
+
+// Splits the search into tasks by enumerating the first rows, one row
+// deeper at a time until there are enough tasks to balance the threads.
+vector<Task> split(int threads){
+    vector<Task> tasks;
+    for(int c=0;c<(N+1)/2;c++){
+        Task t{1, N%2 && c==N/2 ? 1 : 2, 1u<<c, 1u<<c<<1, 1u<<c>>1, vector<int>(N, -1)};
+        t.cols[0]=c;
+        tasks.push_back(t);
+    }
+    while(tasks.size()<(size_t)threads*64 && !tasks.empty() && tasks[0].row<N-1){
+        vector<Task> next;
+        for(auto& t:tasks){
+            uint32_t avail=full & ~(t.used|t.ld|t.rd);
+            while(avail){
+                uint32_t bit=avail & -avail;
+                avail^=bit;
+                Task u{t.row+1, t.weight, t.used|bit, (t.ld|bit)<<1, (t.rd|bit)>>1, t.cols};
+                u.cols[t.row]=__builtin_ctz(bit);
+                next.push_back(move(u));
+            }
+        }
+        tasks.swap(next);
+    }
+    return tasks;
+}
+
+// Each thread owns a deque of task numbers, dealt round-robin; it takes
+// from the back of its own and, once that is empty, steals from the front
+// of the others'.
+struct Pool {
+    struct Queue { mutex m; deque<int> tasks; };
+    vector<Queue> queues;
+    Pool(int threads, int tasks): queues(threads) {
+        for(int i=0;i<tasks;i++) queues[i%threads].tasks.push_back(i);
+    }
+    bool next(int self, int& task){
+        int n=queues.size();
+        for(int k=0;k<n;k++){
+            Queue& q=queues[(self+k)%n];
+            lock_guard<mutex> g(q.m);
+            if(q.tasks.empty()) continue;
+            if(k==0){ task=q.tasks.back(); q.tasks.pop_back(); }
+            else{ task=q.tasks.front(); q.tasks.pop_front(); }
+            return true;
+        }
+        return false;
+    }
+};
+
+// Per-thread line buffer for streamed solutions, written to stdout in
+// blocks under a shared lock so lines from different threads never mix.
+struct Writer {
+    static mutex out;
+    string buf;
+    void line(const vector<int>& q){
+        char digits[12];
+        for(int r=0;r<N;r++){
+            int c=q[r], n=0;
+            do digits[n++]='0'+c%10; while(c/=10);
+            while(n) buf+=digits[--n];
+            buf+=r+1<N ? ' ' : '\n';
+        }
+        if(buf.size()>=1<<16) flush();
+    }
+    void flush(){
+        lock_guard<mutex> g(out);
+        fwrite(buf.data(), 1, buf.size(), stdout);
+        buf.clear();
+    }
+    ~Writer(){ flush(); }
+};
+mutex Writer::out;
+
+enum Mode { CLASSIFY, COUNT, LIST, LIST_UNIQUE };
+
+// Runs every task on the pool. Each thread counts into its own Classes
+// (COUNT and LIST fill only total), and these are added up at the end.
+Classes solve(Mode mode, int threads){
+    vector<Task> tasks=split(threads);
+    threads=max(1, min<int>(threads, tasks.size()));
+    Pool pool(threads, tasks.size());
+    Classes result;
+    mutex m;
+    auto worker=[&](int self){
+        Classes mine;
+        Writer out;
+        vector<int> cols(N), mirror(N);
+        int weight=1;
+        auto visit=[&]{
+            if(mode==CLASSIFY) mine.add(cols);
+            else if(mode==LIST_UNIQUE){ if(mine.add(cols)) out.line(cols); }
+            else{
+                out.line(cols);
+                if(weight==2){
+                    for(int r=0;r<N;r++) mirror[r]=N-1-cols[r];
+                    out.line(mirror);
+                }
+                mine.total+=weight;
+            }
+            return false;
+        };
+        for(int id;pool.next(self, id);){
+            Task& t=tasks[id];
+            if(mode==COUNT){ mine.total+=t.weight*(t.row==N ? 1 : count(t.row, t.used, t.ld, t.rd)); continue; }
+            copy(t.cols.begin(), t.cols.begin()+t.row, cols.begin());
+            weight=t.weight;
+            search(t.row, t.used, t.ld, t.rd, cols, visit);
+        }
+        lock_guard<mutex> g(m);
+        result.merge(mine);
+    };
+    vector<thread> pool_threads;
+    for(int t=1;t<threads;t++) pool_threads.emplace_back(worker, t);
+    worker(0);
+    for(auto& th:pool_threads) th.join();
+    return result;
+}
+
+// Min-conflicts repair for a single solution on large boards, after Sosic
+// and Gu: the queens stay a permutation (one per row and one per column, so
+// every column count is 1 throughout) and only diagonals can clash;
+// d1[r+c] and d2[r-c+N-1] count the queens on each. A move swaps the
+// columns of two rows and is priced from the four diagonals it touches, in
+// O(1). The start places rows in order, each at a random unused column
+// that no earlier queen attacks if a few tries find one, which leaves only
+// a handful of clashes near the last rows for the repair to fix.
+struct MinConflicts {
+    int n;
+    vector<int> q, d1, d2;
+    mt19937_64 rng;
+    long long swaps=0;
+    MinConflicts(int n, uint64_t seed): n(n), q(n), d1(2*n), d2(2*n), rng(seed) {}
+
+    void put(int r, int c, int k){ d1[r+c]+=k; d2[r-c+n-1]+=k; }
+    int attacks(int r) const { return d1[r+q[r]]+d2[r-q[r]+n-1]-2; }
+    bool free_diagonals(int r, int c) const { return d1[r+c]==0 && d2[r-c+n-1]==0; }
+
+    void init(){
+        fill(d1.begin(), d1.end(), 0); fill(d2.begin(), d2.end(), 0);
+        for(int c=0;c<n;c++) q[c]=c;
+        for(int r=0;r<n;r++){
+            for(int tries=0;tries<32;tries++){
+                int j=r+rng()%(n-r);
+                swap(q[r], q[j]);
+                if(free_diagonals(r, q[r])) break;
+            }
+            put(r, q[r], 1);
+        }
+    }
+    // Swaps the columns of rows i and j if that lowers the number of
+    // attacking pairs; each removal and insertion changes it by the number
+    // of queens already on the two diagonals involved.
+    bool try_swap(int i, int j){
+        int a=q[i], b=q[j];
+        long long delta=0;
+        put(i, a, -1); delta-=d1[i+a]+d2[i-a+n-1];
+        put(j, b, -1); delta-=d1[j+b]+d2[j-b+n-1];
+        delta+=d1[i+b]+d2[i-b+n-1]; put(i, b, 1);
+        delta+=d1[j+a]+d2[j-a+n-1]; put(j, a, 1);
+        if(delta<0){ q[i]=b; q[j]=a; swaps++; return true; }
+        put(j, a, -1); put(i, b, -1); put(i, a, 1); put(j, b, 1);
+        return false;
+    }
+    // Repairs until no queen is attacked; false if max_passes sweeps over
+    // the attacked rows were not enough (the caller restarts).
+    bool repair(int max_passes){
+        vector<int> attacked;
+        for(int pass=0;pass<max_passes;pass++){
+            attacked.clear();
+            for(int r=0;r<n;r++) if(attacks(r)) attacked.push_back(r);
+            if(attacked.empty()) return true;
+            for(int i:attacked)
+                for(int tries=0;tries<min(1000, 8*n) && attacks(i);tries++){
+                    int j=rng()%n;
+                    if(j!=i && try_swap(i, j)) break;
+                }
+        }
+        return false;
+    }
+    int attacked_rows() const {
+        int k=0;
+        for(int r=0;r<n;r++) k+=attacks(r)>0;
+        return k;
+    }
+};
+
+// Checks a placement from scratch: one queen per row (implied by the
+// layout), per column and per diagonal.
+bool valid(const vector<int>& q){
+    int n=q.size();
+    vector<char> col(n, 0), up(2*n, 0), down(2*n, 0);
+    for(int r=0;r<n;r++){
+        int c=q[r];
+        if(c<0 || c>=n || col[c] || up[r+c] || down[r-c+n-1]) return false;
+        col[c]=up[r+c]=down[r-c+n-1]=1;
     }
     return true;
 }
 
-void solve(int r){
-    if(r==N){ solutions.push_back(cols); return; }
-    for(int c=0;c<N;c++){
-        if(safe(r,c)){ cols[r]=c; solve(r+1); }
+int min_conflicts(uint64_t seed, bool list){
+    if(N==2 || N==3){ cout<<"No solution for "<<N<<"-Queens.\n"; return 1; }
+    auto t0=chrono::steady_clock::now();
+    MinConflicts mc(N, seed);
+    int restarts=0, initial;
+    for(;;restarts++){
+        mc.init();
+        initial=mc.attacked_rows();
+        if(mc.repair(100)) break;
     }
+    double secs=chrono::duration<double>(chrono::steady_clock::now()-t0).count();
+    bool ok=valid(mc.q);
+    cerr<<"Placed "<<N<<" queens in "<<secs*1000<<" ms: "<<initial<<" attacked after the greedy start, "
+        <<mc.swaps<<" swaps, "<<restarts<<" restarts; check "<<(ok ? "passed" : "FAILED")<<".\n";
+    if(list && ok){ Writer out; out.line(mc.q); }
+    return ok ? 0 : 1;
 }
 
-int main(){
-    cols.assign(N, -1);
-    solve(0);
-    cout<<"Found "<<solutions.size()<<" solutions for "<<N<<"-Queens.\n";
-    // print first 3 solutions
+int main(int argc, char** argv){
+    Mode mode=CLASSIFY;
+    int threads=thread::hardware_concurrency();
+    bool local=false, list=false;
+    uint64_t seed=1;
+    for(int i=1;i<argc;i++){
+        string a=argv[i];
+        if(a=="--count") mode=COUNT;
+        else if(a=="--list") mode=LIST, list=true;
+        else if(a=="--min-conflicts") local=true;
+        else if(a=="--seed" && i+1<argc) seed=strtoull(argv[++i], nullptr, 10);
+        else if(a=="--list-unique") mode=LIST_UNIQUE;
+        else if(a=="--threads" && i+1<argc) threads=atoi(argv[++i]);
+        else N=atoi(argv[i]);
+    }
+    if(local && N>=1 && N<=100000000) return min_conflicts(seed, list);
+    if(N<1 || N>32 || local){
+        cout<<"Usage: "<<argv[0]<<" [N] [--count | --list | --list-unique] [--threads T]   (1 <= N <= 32)\n"
+            <<"       "<<argv[0]<<" N --min-conflicts [--seed S] [--list]   (1 <= N <= 10^8)\n";
+        return 1;
+    }
+    full=N==32 ? ~0u : (1u<<N)-1;
+    Classes classes=solve(mode, max(1, threads));
+    if(mode==COUNT){
+        cout<<"Found "<<classes.total<<" solutions for "<<N<<"-Queens.\n";
+        return 0;
+    }
+    if(mode==LIST || mode==LIST_UNIQUE){
+        fflush(stdout);
+        if(mode==LIST) cerr<<"Found "<<classes.total<<" solutions for "<<N<<"-Queens.\n";
+        else cerr<<"Found "<<classes.unique<<" distinct solutions for "<<N<<"-Queens.\n";
+        return 0;
+    }
+    cout<<"Found "<<classes.total<<" solutions for "<<N<<"-Queens.\n";
+    cout<<classes.unique<<" distinct up to rotation and reflection ("
+        <<classes.by_size[8]<<" with 8 images, "<<classes.by_size[4]<<" with 4, "<<classes.by_size[2]<<" with 2, "
+        <<classes.by_size[1]<<" with 1).\n";
+
+    // the first 3 solutions in row order come from the unreduced search
+    vector<int> cols(N);
+    auto keep=[&]{ solutions.push_back(cols); return solutions.size()==3; };
+    for(int c=0;c<N;c++){
+        cols[0]=c;
+        if(search(1, 1u<<c, 1u<<c<<1, 1u<<c>>1, cols, keep)) break;
+    }
     for(size_t k=0;k<solutions.size() && k<3;k++){
         cout<<"Solution "<<k+1<<":\n";
         for(int r=0;r<N;r++){
@@ -1,160 +1,459 @@
 #include <iostream>
 #include <vector>
 #include <string>
-#include <sstream>
-#include <unordered_map>
-#include <unordered_set>
-#include <queue>
+#include <string_view>
 #include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <iterator>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 using namespace std;
 
 /*
  Forward Chaining for definite (Horn) clauses.
+ Usage: a7 [rules.txt] [--no-order]   (reads standard input without a file)
  Input format:
  1) Line: initial facts (space separated tokens). Example: A B C
  2) Line: integer R = number of rules
  3) Next R lines: each rule like "P1 P2 => Q" (antecedents separated by spaces, then "=>" or "->", then single conclusion)
- 4) Line: query symbol (single token)
- 
- Output: whether query is entailed and the proof order (derived facts).
+ 4) Remaining lines, in order (at least one): a query symbol, or an update
+      assert P          add P as a fact
+      retract P         withdraw the fact P
+      rule P1 P2 => Q   add a rule
+
+ Output: for each query whether it is entailed at that point, for each update
+ how many facts it added or withdrew, then the derived facts in the order
+ forward chaining found them (unless --no-order).
+
+ The input is mapped (or read) into one buffer and parsed in place: symbols
+ are interned to dense IDs as views into that buffer, and rules are stored
+ in flat CSR arrays. The closure is computed once into a bitset, so each
+ query is a hash lookup and a bit test. A rule with no antecedents states
+ its conclusion as a fact.
+
+ Updates are incremental: the per-rule counts of unknown antecedents are
+ kept between them, so an assertion or a new rule only propagates its own
+ consequences. Every derived fact also records its support, the rule that
+ derived it, whose antecedents were all known earlier. A retraction is
+ delete-and-rederive (DRed) with the deletion limited to the facts whose
+ support chain runs through the retracted fact; those of them that another
+ rule still yields are re-derived, so the cost follows what depended on it.
 */
 
-struct Rule {
-    vector<string> antecedents;
-    string conclusion;
-    int remaining;   // count of antecedents not yet known
-    bool fired = false;
+static inline uint64_t hash_symbol(string_view s) {
+    uint64_t h = 1469598103934665603ull; // FNV-1a
+    for (unsigned char c : s) { h ^= c; h *= 1099511628211ull; }
+    return h;
+}
+
+// Open-addressing table from symbol text to dense ID. The keys are views
+// into the input buffer, which must outlive the table. A slot holds an ID
+// and the high half of its hash, so probing past other symbols never
+// touches the keys. Callers that know their next symbols can prefetch()
+// their slots to overlap the cache misses.
+struct Symbols {
+    struct Slot { int id; uint32_t tag; };
+    vector<Slot> slot = vector<Slot>(1024, Slot{-1, 0});
+    vector<string_view> keys;
+    vector<uint64_t> hashes;
+
+    int size() const { return (int)keys.size(); }
+    string_view name(int id) const { return keys[id]; }
+    void prefetch(uint64_t h) const { __builtin_prefetch(&slot[h & (slot.size() - 1)]); }
+    int intern(string_view s) { return intern(s, hash_symbol(s)); }
+    int intern(string_view s, uint64_t h) {
+        if (2 * keys.size() >= slot.size()) grow();
+        uint32_t tag = h >> 32;
+        size_t mask = slot.size() - 1, i = h & mask;
+        for (; slot[i].id >= 0; i = (i + 1) & mask)
+            if (slot[i].tag == tag && keys[slot[i].id] == s) return slot[i].id;
+        slot[i] = {(int)keys.size(), tag};
+        keys.push_back(s);
+        hashes.push_back(h);
+        return slot[i].id;
+    }
+    // -1 if the symbol never occurs in the input
+    int find(string_view s) const {
+        uint64_t h = hash_symbol(s);
+        uint32_t tag = h >> 32;
+        size_t mask = slot.size() - 1, i = h & mask;
+        for (; slot[i].id >= 0; i = (i + 1) & mask)
+            if (slot[i].tag == tag && keys[slot[i].id] == s) return slot[i].id;
+        return -1;
+    }
+    void grow() {
+        slot.assign(slot.size() * 2, Slot{-1, 0});
+        size_t mask = slot.size() - 1;
+        for (int id = 0; id < size(); id++) {
+            size_t i = hashes[id] & mask;
+            while (slot[i].id >= 0) i = (i + 1) & mask;
+            slot[i] = {id, uint32_t(hashes[id] >> 32)};
+        }
+    }
 };
 
-static inline vector<string> split_ws(const string &s) {
-    vector<string> out;
-    string token;
-    istringstream iss(s);
-    while (iss >> token) out.push_back(token);
-    return out;
+// The whole input as one buffer: a read-only mapping of the file, or
+// standard input read into memory.
+struct Input {
+    const char *data = nullptr;
+    size_t len = 0;
+    void *map = nullptr;
+    string buf;
+
+    Input() = default;
+    Input(const Input &) = delete;
+    Input &operator=(const Input &) = delete;
+    ~Input() { if (map) munmap(map, len); }
+
+    bool open_file(const string &file) {
+        int fd = open(file.c_str(), O_RDONLY);
+        if (fd < 0) { cerr << "Cannot open " << file << "\n"; return false; }
+        struct stat st;
+        fstat(fd, &st);
+        len = st.st_size;
+        if (len > 0) {
+            map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map == MAP_FAILED) { map = nullptr; close(fd); cerr << "mmap failed for " << file << "\n"; return false; }
+            madvise(map, len, MADV_SEQUENTIAL);
+            data = (const char *)map;
+        }
+        close(fd);
+        return true;
+    }
+    void read_stdin() {
+        buf.assign(istreambuf_iterator<char>(cin), istreambuf_iterator<char>());
+        data = buf.data();
+        len = buf.size();
+    }
+};
+
+// Cuts lines and whitespace-separated tokens out of the buffer without copying.
+struct Cursor {
+    const char *p, *end;
+    bool next_line(string_view &line) {
+        if (p >= end) return false;
+        const char *eol = (const char *)memchr(p, '\n', end - p);
+        if (!eol) eol = end;
+        line = string_view(p, eol - p);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        p = eol + 1;
+        return true;
+    }
+};
+
+template <class F> static inline void for_each_token(string_view s, F f) {
+    size_t i = 0, n = s.size();
+    while (true) {
+        while (i < n && isspace((unsigned char)s[i])) i++;
+        if (i == n) return;
+        size_t j = i;
+        while (j < n && !isspace((unsigned char)s[j])) j++;
+        f(s.substr(i, j - i));
+        i = j;
+    }
 }
 
-int main() {
-    ios::sync_with_stdio(false);
-    cin.tie(nullptr);
+// Horn clauses in CSR form. Rule i has antecedents body[body_off[i] ..
+// body_off[i+1]) and conclusion head[i]; the rules with symbol s among
+// their antecedents are uses[use_off[s] .. use_off[s+1]), once per
+// occurrence, matching the count in remaining, and the rules concluding s
+// are by_head[head_off[s] .. head_off[s+1]). Rules added after loading are
+// appended to the rule arrays, and indexed by the added_* lists instead.
+struct KB {
+    Symbols symbols;
+    vector<int> facts;
+    vector<int> body_off{0}, body, head;
+    vector<int> use_off{0}, uses, head_off{0}, by_head;
+    vector<vector<int>> added_uses, added_by_head;
+    vector<int> remaining;   // per rule: antecedent occurrences not known
+    vector<uint64_t> known;  // closure, one bit per symbol
+    vector<char> asserted;
+    vector<int> support;     // per known symbol: the rule that derived it, or -1 if asserted
+    vector<int> order;       // known symbols as learned; -1 where one was since withdrawn
+    vector<int> order_pos;   // per known symbol: its entry in order
+    size_t dropped = 0;      // -1 entries in order
+    size_t learned = 0;      // facts learned so far, for the update counts
+    vector<int> agenda, withdrawn;
 
-    string line;
-    // Read facts line
-    if (!getline(cin, line)) return 0;
-    vector<string> facts = split_ws(line);
+    int rules() const { return (int)head.size(); }
+    bool is_known(int s) const { return s >= 0 && (size_t)(s >> 6) < known.size() && (known[s >> 6] >> (s & 63) & 1); }
 
-    // Read number of rules
-    if (!getline(cin, line)) return 0;
-    int R = stoi(line);
+    // Parses the facts and rules; in is left at the first line after them.
+    bool parse(Cursor &in) {
+        string_view line;
+        if (!in.next_line(line)) return false;
+        for_each_token(line, [&](string_view t) { facts.push_back(symbols.intern(t)); });
 
-    vector<Rule> rules;
-    rules.reserve(R);
+        if (!in.next_line(line)) return false;
+        int R = atoi(string(line).c_str());
+        head.reserve(R);
+        body_off.reserve(R + 1);
 
-    // For each rule, parse antecedents and conclusion
-    for (int i = 0; i < R; ++i) {
-        if (!getline(cin, line)) {
-            cerr << "Unexpected end of input while reading rules.\n";
-            return 0;
-        }
-        // Normalize arrow tokens
-        size_t pos = line.find("->");
-        if (pos != string::npos) line.replace(pos, 2, "=>");
-
-        // Split by "=>"
-        size_t arrow = line.find("=>");
-        if (arrow == string::npos) {
-            cerr << "Rule format error on line " << (i+1) << ". Use: P1 P2 => Q\n";
-            return 0;
-        }
-        string left = line.substr(0, arrow);
-        string right = line.substr(arrow + 2);
-
-        vector<string> antecedents = split_ws(left);
-        vector<string> rhs = split_ws(right);
-        if (rhs.size() != 1) {
-            cerr << "Each rule must have exactly one symbol on the right-hand side.\n";
-            return 0;
+        // Rules are tokenized a block at a time and their slots prefetched
+        // before any is interned, so the table's cache misses overlap.
+        struct Token { string_view text; uint64_t hash; };
+        vector<Token> tokens;
+        vector<int> ends;   // per rule: end of its tokens; the last one is the conclusion
+        for (int i = 0; i < R;) {
+            tokens.clear();
+            ends.clear();
+            for (; i < R && ends.size() < 256; ++i) {
+                if (!in.next_line(line)) {
+                    cerr << "Unexpected end of input while reading rules.\n";
+                    return false;
+                }
+                // the first "=>" or "->" splits the rule
+                size_t arrow = string_view::npos;
+                for (size_t k = 0; k + 1 < line.size(); k++)
+                    if ((line[k] == '=' || line[k] == '-') && line[k + 1] == '>') { arrow = k; break; }
+                if (arrow == string_view::npos) {
+                    cerr << "Rule format error on line " << (i+1) << ". Use: P1 P2 => Q\n";
+                    return false;
+                }
+                auto add = [&](string_view t) {
+                    uint64_t h = hash_symbol(t);
+                    symbols.prefetch(h);
+                    tokens.push_back({t, h});
+                };
+                for_each_token(line.substr(0, arrow), add);
+                size_t before = tokens.size();
+                for_each_token(line.substr(arrow + 2), add);
+                if (tokens.size() != before + 1) {
+                    cerr << "Each rule must have exactly one symbol on the right-hand side.\n";
+                    return false;
+                }
+                ends.push_back((int)tokens.size());
+            }
+            int k = 0;
+            for (int end : ends) {
+                for (; k < end - 1; k++) body.push_back(symbols.intern(tokens[k].text, tokens[k].hash));
+                head.push_back(symbols.intern(tokens[k].text, tokens[k].hash));
+                body_off.push_back((int)body.size());
+                k++;
+            }
         }
 
-        Rule r;
-        r.antecedents = std::move(antecedents);
-        r.conclusion = rhs[0];
-        r.remaining = static_cast<int>(r.antecedents.size());
-        rules.push_back(std::move(r));
+        return true;
     }
 
-    // Read query
-    if (!getline(cin, line)) {
-        cerr << "Missing query line\n";
-        return 0;
+    // Inverts the rule bodies and heads into the per-symbol indexes.
+    void build_index() {
+        int S = symbols.size();
+        auto invert = [&](vector<int> &off, vector<int> &out, auto each) {
+            off.assign(S + 1, 0);
+            for (int r = 0; r < rules(); r++) each(r, [&](int s) { off[s + 1]++; });
+            for (int s = 0; s < S; s++) off[s + 1] += off[s];
+            out.resize(off[S]);
+            vector<int> next(off.begin(), off.end() - 1);
+            for (int r = 0; r < rules(); r++) each(r, [&](int s) { out[next[s]++] = r; });
+        };
+        invert(use_off, uses, [&](int r, auto f) { for (int k = body_off[r]; k < body_off[r + 1]; k++) f(body[k]); });
+        invert(head_off, by_head, [&](int r, auto f) { f(head[r]); });
+        grow_symbols();
+    }
+    // Sizes the per-symbol state for symbols interned since.
+    void grow_symbols() {
+        size_t S = symbols.size();
+        known.resize((S + 63) / 64, 0);
+        asserted.resize(S, 0);
+        support.resize(S, -1);
+        order_pos.resize(S, -1);
+        added_uses.resize(S);
+        added_by_head.resize(S);
     }
-    string query;
-    {
-        istringstream iss(line);
-        iss >> query;
+    template <class F> void for_uses(int s, F f) const {
+        if (s + 1 < (int)use_off.size()) for (int k = use_off[s]; k < use_off[s + 1]; k++) f(uses[k]);
+        for (int r : added_uses[s]) f(r);
+    }
+    template <class F> void for_rules_concluding(int s, F f) const {
+        if (s + 1 < (int)head_off.size()) for (int k = head_off[s]; k < head_off[s + 1]; k++) f(by_head[k]);
+        for (int r : added_by_head[s]) f(r);
     }
 
-    // Build index: for each symbol, which rules have it in antecedents
-    unordered_map<string, vector<int>> index;
-    for (int i = 0; i < (int)rules.size(); ++i) {
-        for (const auto &ant : rules[i].antecedents) {
-            index[ant].push_back(i);
-        }
+    void learn(int s, int rule) {
+        if (is_known(s)) return;
+        known[s >> 6] |= 1ull << (s & 63);
+        support[s] = rule;
+        order_pos[s] = (int)order.size();
+        order.push_back(s);
+        learned++;
+        agenda.push_back(s);
+    }
+    // Forward chaining from the agenda; counts the rules each new fact
+    // completes.
+    void propagate() {
+        for (size_t i = 0; i < agenda.size(); i++)
+            for_uses(agenda[i], [&](int r) { if (--remaining[r] == 0) learn(head[r], r); });
+        agenda.clear();
     }
 
-    // Agenda: queue of known facts to process
-    queue<string> agenda;
-    unordered_set<string> inferred; 
-    vector<string> derivedOrder;
+    // The closure of the loaded facts and rules.
+    void closure() {
+        remaining.resize(rules());
+        for (int f : facts) { asserted[f] = 1; learn(f, -1); }
+        for (int r = 0; r < rules(); r++) {
+            remaining[r] = body_off[r + 1] - body_off[r];
+            if (!remaining[r]) learn(head[r], r);
+        }
+        propagate();
+    }
 
-    // initialize with given facts
-    for (const auto &f : facts) {
-        if (inferred.insert(f).second) {
-            agenda.push(f);
-            derivedOrder.push_back(f);
+    // Each update returns how many facts it added (or withdrew).
+    int assert_fact(int s) {
+        grow_symbols();
+        asserted[s] = 1;
+        support[s] = -1;
+        size_t before = learned;
+        learn(s, -1);
+        propagate();
+        return learned - before;
+    }
+    int add_rule(const vector<int> &antecedents, int conclusion) {
+        grow_symbols();
+        int r = rules();
+        int unknown = 0;
+        for (int s : antecedents) {
+            body.push_back(s);
+            added_uses[s].push_back(r);
+            unknown += !is_known(s);
         }
+        body_off.push_back((int)body.size());
+        head.push_back(conclusion);
+        added_by_head[conclusion].push_back(r);
+        remaining.push_back(unknown);
+        size_t before = learned;
+        if (!unknown) learn(conclusion, r);
+        propagate();
+        return learned - before;
+    }
+    // Delete: withdraw s, then every fact supported by a rule that uses a
+    // withdrawn fact. Supports only point back in time, so whatever is
+    // still known keeps a support chain down to asserted facts that avoids
+    // s. Rederive: a withdrawn fact concluded by a rule whose antecedents
+    // are all still known comes back, and forward chaining from those
+    // restores the rest.
+    int retract(int s) {
+        grow_symbols();
+        if (s < 0 || !asserted[s]) return 0;
+        asserted[s] = 0;
+        withdrawn.clear();
+        auto withdraw = [&](int p) {
+            known[p >> 6] &= ~(1ull << (p & 63));
+            order[order_pos[p]] = -1;
+            dropped++;
+            withdrawn.push_back(p);
+        };
+        withdraw(s);
+        for (size_t i = 0; i < withdrawn.size(); i++)
+            for_uses(withdrawn[i], [&](int r) {
+                if (remaining[r]++ == 0 && is_known(head[r]) && support[head[r]] == r) withdraw(head[r]);
+            });
+        for (int p : withdrawn)
+            for_rules_concluding(p, [&](int r) { if (remaining[r] == 0) learn(p, r); });
+        propagate();
+        int lost = 0;
+        for (int p : withdrawn) lost += !is_known(p);
+        // squeeze out withdrawn entries once they are half of order, so it
+        // stays within twice the closure however many updates come
+        if (dropped * 2 > order.size()) {
+            size_t n = 0;
+            for (int p : order) if (p >= 0) { order_pos[p] = (int)n; order[n++] = p; }
+            order.resize(n);
+            dropped = 0;
+        }
+        return lost;
     }
 
-    bool entailed = false;
-    if (inferred.count(query)) entailed = true;
-
-    // Forward chaining loop
-    while (!agenda.empty() && !entailed) {
-        string p = agenda.front(); 
-        agenda.pop();
-
-        // For each rule that has p as an antecedent, decrement remaining
-        auto it = index.find(p);
-        if (it == index.end()) continue;
-        for (int ruleIdx : it->second) {
-            Rule &r = rules[ruleIdx];
-            if (r.fired) continue; 
-            r.remaining--;
-            if (r.remaining == 0) {
-                // All antecedents satisfied -> infer conclusion if not already known
-                if (inferred.insert(r.conclusion).second) {
-                    agenda.push(r.conclusion);
-                    derivedOrder.push_back(r.conclusion);
-                    if (r.conclusion == query) {
-                        entailed = true;
-                        r.fired = true;
-                        break;
-                    }
-                }
-                r.fired = true;
+    bool entailed(string_view query) const { return is_known(symbols.find(query)); }
+};
+
+// Splits "P1 P2 => Q" (or "->") into interned antecedents and conclusion;
+// false if the line is not a rule with a single conclusion.
+static bool parse_rule(Symbols &symbols, string_view line, vector<int> &antecedents, int &conclusion) {
+    size_t arrow = string_view::npos;
+    for (size_t k = 0; k + 1 < line.size(); k++)
+        if ((line[k] == '=' || line[k] == '-') && line[k + 1] == '>') { arrow = k; break; }
+    if (arrow == string_view::npos) return false;
+    int count = 0;
+    for_each_token(line.substr(arrow + 2), [&](string_view t) { if (count++ == 0) conclusion = symbols.intern(t); });
+    if (count != 1) return false;
+    antecedents.clear();
+    for_each_token(line.substr(0, arrow), [&](string_view t) { antecedents.push_back(symbols.intern(t)); });
+    return true;
+}
+
+int main(int argc, char **argv) {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+
+    string file;
+    bool print_order = true;
+    for (int i = 1; i < argc; i++) {
+        string a = argv[i];
+        if (a == "--no-order") print_order = false;
+        else file = a;
+    }
+
+    Input input;
+    if (file.empty()) input.read_stdin();
+    else if (!input.open_file(file)) return 1;
+
+    KB kb;
+    Cursor in{input.data, input.data + input.len};
+    if (!kb.parse(in)) return 0;
+    kb.build_index();
+    kb.closure();
+
+    string_view line;
+    vector<int> antecedents;
+    int commands = 0;
+    while (in.next_line(line)) {
+        string_view word, arg;
+        for_each_token(line, [&](string_view t) {
+            if (word.empty()) word = t;
+            else if (arg.empty()) arg = t;
+        });
+        if (word.empty()) continue;
+        commands++;
+        if (word == "assert" && !arg.empty()) {
+            int n = kb.assert_fact(kb.symbols.intern(arg));
+            cout << "Asserted " << arg << ": " << n << " new facts.\n";
+        } else if (word == "retract" && !arg.empty()) {
+            int n = kb.retract(kb.symbols.find(arg));
+            cout << "Retracted " << arg << ": " << n << " facts withdrawn.\n";
+        } else if (word == "rule") {
+            int conclusion = -1;
+            string_view text = line.substr(word.data() + word.size() - line.data());
+            if (!parse_rule(kb.symbols, text, antecedents, conclusion)) {
+                cerr << "Rule format error: " << text << ". Use: rule P1 P2 => Q\n";
+                continue;
             }
+            int n = kb.add_rule(antecedents, conclusion);
+            cout << "Added rule: " << n << " new facts.\n";
+        } else if (kb.entailed(word)) {
+            cout << "Query " << word << " is entailed by the knowledge base.\n";
+        } else {
+            cout << "Query " << word << " is NOT entailed by the knowledge base.\n";
         }
     }
-
-    if (entailed) {
-        cout << "Query " << query << " is entailed by the knowledge base.\n";
-    } else {
-        cout << "Query " << query << " is NOT entailed by the knowledge base.\n";
+    if (!commands) {
+        cerr << "Missing query line\n";
+        return 0;
     }
 
-    cout << "Derived facts order (" << derivedOrder.size() << "):\n";
-    for (size_t i = 0; i < derivedOrder.size(); ++i) {
-        cout << i+1 << ". " << derivedOrder[i] << "\n";
+    if (print_order) {
+        // the current closure, each fact at the point it was last learned
+        vector<int> facts;
+        for (int s : kb.order) if (s >= 0) facts.push_back(s);
+        cout << "Derived facts order (" << facts.size() << "):\n";
+        for (size_t i = 0; i < facts.size(); ++i) {
+            cout << i+1 << ". " << kb.symbols.name(facts[i]) << "\n";
+        }
     }
 
     return 0;